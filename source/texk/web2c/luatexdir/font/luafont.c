@@ -1354,6 +1354,7 @@ static void font_char_from_lua(lua_State * L, internal_font_number f, int i, int
     int atsize = font_size(f);
     if (lua_istable(L, -1)) {
         co = get_charinfo(f, i);
+        font_generation++;
         set_charinfo_tag(co, 0);
         j = lua_numeric_field_by_index(L, lua_key_index(width), 0);
         set_charinfo_width(co, j);
@@ -2528,8 +2529,7 @@ halfword handle_ligaturing(halfword head, halfword tail)
 
 static void add_kern_before(halfword left, halfword right)
 {
-    if ((!is_rightghost(right)) &&
-        font(left) == font(right) && has_kern(font(left), character(left))) {
+    if ((!is_rightghost(right)) && font(left) == font(right)) {
         int k = raw_get_kern(font(left), character(left), character(right));
         if (k != 0) {
             halfword kern = new_kern(k);
@@ -2546,8 +2546,7 @@ static void add_kern_before(halfword left, halfword right)
 
 static void add_kern_after(halfword left, halfword right, halfword aft)
 {
-    if ((!is_rightghost(right)) &&
-        font(left) == font(right) && has_kern(font(left), character(left))) {
+    if ((!is_rightghost(right)) && font(left) == font(right)) {
         int k = raw_get_kern(font(left), character(left), character(right));
         if (k != 0) {
             halfword kern = new_kern(k);
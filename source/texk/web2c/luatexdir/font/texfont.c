@@ -57,6 +57,25 @@ texfont **font_tables = NULL;
 static int font_arr_max = 0;
 static int font_id_maxval = 0;
 
+/*tex
+
+    Ligature and kern lookups are cached per font and character pair, the
+    packers keep the dimensions of the first characters of a font in a dense
+    array, and math caches extensibles. Every change to character data bumps a generation number
+    and a cache that is older than that is emptied on its next use.
+
+*/
+
+int font_generation = 1;
+
+static void free_ligkern_cache(internal_font_number f)
+{
+    xfree(font_tables[f]->_ligkern_cache);
+    font_tables[f]->_ligkern_cache = NULL;
+    xfree(font_tables[f]->_metric_cache);
+    font_tables[f]->_metric_cache = NULL;
+}
+
 static void grow_font_table(int id)
 {
     int j;
@@ -175,6 +194,7 @@ charinfo *get_charinfo(internal_font_number f, int c)
                 font_malloc_charinfo(f, 256);
             }
             font_tables[f]->_charinfo[tglyph].ef = 1000;
+            font_generation++;
             sa_value.int_value = tglyph;
             /*tex 1 means global */
             set_sa_item(font_tables[f]->_characters, c, sa_value, 1);
@@ -202,6 +222,7 @@ charinfo *get_charinfo(internal_font_number f, int c)
 static void set_charinfo(internal_font_number f, int c, charinfo * ci)
 {
     int glyph;
+    font_generation++;
     if (proper_char_index(c)) {
         glyph = get_sa_item(font_tables[f]->_characters, c).int_value;
         if (glyph) {
@@ -340,6 +361,35 @@ scaled_whd get_charinfo_whd(internal_font_number f, int c)
     return s;
 }
 
+/*tex
+
+    The packers add up the dimensions of every glyph in a list. For the first
+    |metric_cache_size| characters of a font we keep these in a dense array so
+    that a run of glyphs needs no lookup in the character tree. Height and depth
+    are clipped at zero, like |glyph_height| and |glyph_depth| do.
+
+*/
+
+scaled_whd *get_metric_cache(internal_font_number f)
+{
+    texfont *tf = font_tables[f];
+    if (tf->_metric_cache == NULL || tf->_metric_generation != font_generation) {
+        int c;
+        if (tf->_metric_cache == NULL)
+            tf->_metric_cache = xmalloc(metric_cache_size * sizeof(scaled_whd));
+        for (c = 0; c < metric_cache_size; c++) {
+            scaled_whd s = get_charinfo_whd(f, c);
+            if (s.ht < 0)
+                s.ht = 0;
+            if (s.dp < 0)
+                s.dp = 0;
+            tf->_metric_cache[c] = s;
+        }
+        tf->_metric_generation = font_generation;
+    }
+    return tf->_metric_cache;
+}
+
 int char_exists(internal_font_number f, int c)
 {
     if (f > font_id_maxval)
@@ -516,16 +566,20 @@ static extinfo *undump_charinfo_variants(void)
 void set_charinfo_width(charinfo * ci, scaled val)
 {
     ci->width = val;
+    ci->expansion_set = 0;
+    font_generation++;
 }
 
 void set_charinfo_height(charinfo * ci, scaled val)
 {
     ci->height = val;
+    font_generation++;
 }
 
 void set_charinfo_depth(charinfo * ci, scaled val)
 {
     ci->depth = val;
+    font_generation++;
 }
 
 void set_charinfo_italic(charinfo * ci, scaled val)
@@ -583,11 +637,13 @@ void set_charinfo_tounicode(charinfo * ci, char *val)
 void set_charinfo_ligatures(charinfo * ci, liginfo * val)
 {
     dxfree(ci->ligatures, val);
+    font_generation++;
 }
 
 void set_charinfo_kerns(charinfo * ci, kerninfo * val)
 {
     dxfree(ci->kerns, val);
+    font_generation++;
 }
 
 void set_charinfo_packets(charinfo * ci, eight_bits * val)
@@ -598,6 +654,7 @@ void set_charinfo_packets(charinfo * ci, eight_bits * val)
 void set_charinfo_ef(charinfo * ci, scaled val)
 {
     ci->ef = val;
+    ci->expansion_set = 0;
 }
 
 void set_charinfo_lp(charinfo * ci, scaled val)
@@ -944,6 +1001,64 @@ scaled calc_char_width(internal_font_number f, int c, int ex)
     return w;
 }
 
+/*tex
+
+    When \.{\adjustspacing} is enabled the line breaker and the packager ask
+    for the amount a character can stretch or shrink over and over again, so we
+    calculate these once per character and keep them in the |charinfo|. They
+    depend on the width, the |ef| code and the expansion limits of the font, so
+    they are recalculated when one of these changes.
+
+*/
+
+static void set_charinfo_expansion(internal_font_number f, charinfo * ci)
+{
+    scaled w = get_charinfo_width(ci);
+    int ef = get_charinfo_ef(ci);
+    int m;
+    ci->expansion_stretch = 0;
+    ci->expansion_shrink = 0;
+    if (ef > 0) {
+        m = font_max_stretch(f);
+        if (m > 0) {
+            scaled dw = round_xn_over_d(w, 1000 + m, 1000) - w;
+            if (dw > 0)
+                ci->expansion_stretch = round_xn_over_d(dw, ef, 1000);
+        }
+        m = font_max_shrink(f);
+        if (m > 0) {
+            scaled dw = w - round_xn_over_d(w, 1000 - m, 1000);
+            if (dw > 0)
+                ci->expansion_shrink = round_xn_over_d(dw, ef, 1000);
+        }
+    }
+    ci->expansion_set = 1;
+}
+
+scaled char_expansion_stretch(internal_font_number f, int c)
+{
+    charinfo *ci = char_info(f, c);
+    if (!ci->expansion_set)
+        set_charinfo_expansion(f, ci);
+    return ci->expansion_stretch;
+}
+
+scaled char_expansion_shrink(internal_font_number f, int c)
+{
+    charinfo *ci = char_info(f, c);
+    if (!ci->expansion_set)
+        set_charinfo_expansion(f, ci);
+    return ci->expansion_shrink;
+}
+
+void reset_font_expansion(internal_font_number f)
+{
+    int i;
+    for (i = 0; i <= font_tables[f]->_charinfo_count; i++) {
+        font_tables[f]->_charinfo[i].expansion_set = 0;
+    }
+}
+
 scaled char_depth(internal_font_number f, int c)
 {
     charinfo *ci = char_info(f, c);
@@ -1093,6 +1208,8 @@ int copy_font(int f)
     font_tables[k]->_font_cidordering = NULL;
     font_tables[k]->_left_boundary = NULL;
     font_tables[k]->_right_boundary = NULL;
+    font_tables[k]->_ligkern_cache = NULL;
+    font_tables[k]->_metric_cache = NULL;
     set_font_name(k, xstrdup(font_name(f)));
     if (font_filename(f) != NULL)
         set_font_filename(k, xstrdup(font_filename(f)));
@@ -1154,6 +1271,7 @@ void delete_font(int f)
         set_font_cidordering(f, NULL);
         set_left_boundary(f, NULL);
         set_right_boundary(f, NULL);
+        free_ligkern_cache(f);
         for (i = font_bc(f); i <= font_ec(f); i++) {
             if (quick_char_exists(f, i)) {
                 co = char_info(f, i);
@@ -1352,7 +1470,7 @@ void set_no_ligatures(internal_font_number f)
     font_tables[f]->_ligatures_disabled = 1;
 }
 
-liginfo get_ligature(internal_font_number f, int lc, int rc)
+static liginfo find_ligature(internal_font_number f, int lc, int rc)
 {
     int k = 0;
     liginfo t, u;
@@ -1360,7 +1478,7 @@ liginfo get_ligature(internal_font_number f, int lc, int rc)
     t.lig = 0;
     t.type = 0;
     t.adj = 0;
-    if (lc == non_boundarychar || rc == non_boundarychar || (!has_lig(f, lc)))
+    if (!has_lig(f, lc))
         return t;
     co = char_info(f, lc);
     while (1) {
@@ -1379,12 +1497,12 @@ liginfo get_ligature(internal_font_number f, int lc, int rc)
     return t;
 }
 
-scaled raw_get_kern(internal_font_number f, int lc, int rc)
+static scaled find_kern(internal_font_number f, int lc, int rc)
 {
     int k = 0;
     kerninfo u;
     charinfo *co;
-    if (lc == non_boundarychar || rc == non_boundarychar)
+    if (!has_kern(f, lc))
         return 0;
     co = char_info(f, lc);
     while (1) {
@@ -1402,10 +1520,57 @@ scaled raw_get_kern(internal_font_number f, int lc, int rc)
     return 0;
 }
 
-scaled get_kern(internal_font_number f, int lc, int rc)
+/*tex
+
+    The cache is direct mapped: a pair that is not there replaces whatever sits
+    in its slot. Both the ligature and the kern are looked up at that time, as
+    the ligature and kerning passes ask for the same pairs.
+
+*/
+
+static ligkerninfo *get_ligkern(internal_font_number f, int lc, int rc)
 {
-    if (lc == non_boundarychar || rc == non_boundarychar || (!has_kern(f, lc)))
+    texfont *tf = font_tables[f];
+    ligkerninfo *p;
+    if (tf->_ligkern_cache == NULL || tf->_ligkern_generation != font_generation) {
+        int i;
+        if (tf->_ligkern_cache == NULL)
+            tf->_ligkern_cache = xmalloc(ligkern_cache_size * sizeof(ligkerninfo));
+        for (i = 0; i < ligkern_cache_size; i++)
+            tf->_ligkern_cache[i].left = non_boundarychar;
+        tf->_ligkern_generation = font_generation;
+    }
+    p = &tf->_ligkern_cache[((unsigned) lc * 31 + (unsigned) rc) & (ligkern_cache_size - 1)];
+    if (p->left != lc || p->right != rc) {
+        p->left = lc;
+        p->right = rc;
+        p->lig = find_ligature(f, lc, rc);
+        p->kern = find_kern(f, lc, rc);
+    }
+    return p;
+}
+
+liginfo get_ligature(internal_font_number f, int lc, int rc)
+{
+    if (lc == non_boundarychar || rc == non_boundarychar) {
+        liginfo t;
+        t.lig = 0;
+        t.type = 0;
+        t.adj = 0;
+        return t;
+    }
+    return get_ligkern(f, lc, rc)->lig;
+}
+
+scaled raw_get_kern(internal_font_number f, int lc, int rc)
+{
+    if (lc == non_boundarychar || rc == non_boundarychar)
         return 0;
+    return get_ligkern(f, lc, rc)->kern;
+}
+
+scaled get_kern(internal_font_number f, int lc, int rc)
+{
     return raw_get_kern(f, lc, rc);
 }
 
@@ -1818,6 +1983,7 @@ void set_expand_params(internal_font_number f, int stretch_limit, int shrink_lim
     set_font_step(f, font_step);
     set_font_max_shrink(f, shrink_limit);
     set_font_max_stretch(f, stretch_limit);
+    reset_font_expansion(f);
 }
 
 /*tex
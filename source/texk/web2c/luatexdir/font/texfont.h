@@ -69,6 +69,19 @@ typedef struct kerninfo {
 #  endif
 } kerninfo;
 
+/* a cache of ligature and kern lookups per character pair */
+
+typedef struct ligkerninfo {
+    int left;
+    int right;
+    liginfo lig;
+    scaled kern;
+} ligkerninfo;
+
+#  define ligkern_cache_size 1024
+
+#  define metric_cache_size 256
+
 typedef struct extinfo {
     struct extinfo *next;
     int glyph;
@@ -99,6 +112,9 @@ typedef struct charinfo {
     int rp;                     /* right protruding factor */
     char tag;                   /* list / ext taginfo */
     char used;                  /* char is typeset ? */
+    char expansion_set;         /* are the two next values valid ? */
+    scaled expansion_stretch;   /* precalculated width stretch, depends on ef and font limits */
+    scaled expansion_shrink;    /* precalculated width shrink, depends on ef and font limits */
     char *tounicode;            /* unicode equivalent */
     extinfo *hor_variants;      /* horizontal variants */
     extinfo *vert_variants;     /* vertical variants */
@@ -181,6 +197,10 @@ typedef struct texfont {
     int         _charinfo_size;
     charinfo   *_charinfo;
     int         _ligatures_disabled;
+    ligkerninfo *_ligkern_cache;      /* internal information */
+    int         _ligkern_generation;  /* internal information */
+    scaled_whd *_metric_cache;        /* internal information */
+    int         _metric_generation;   /* internal information */
     int         _pdf_font_num;        /* maps to a PDF resource ID */
     str_number  _pdf_font_attr;       /* pointer to additional attributes */
 } texfont;
@@ -562,6 +582,9 @@ extern int ext_mid(internal_font_number f, int c);
 
 extern scaled char_height(internal_font_number f, int c);
 extern scaled calc_char_width(internal_font_number f, int c, int ex);
+extern scaled char_expansion_stretch(internal_font_number f, int c);
+extern scaled char_expansion_shrink(internal_font_number f, int c);
+extern void reset_font_expansion(internal_font_number f);
 extern scaled char_width(internal_font_number f, int c);
 extern scaled char_depth(internal_font_number f, int c);
 extern scaled char_italic(internal_font_number f, int c);
@@ -586,6 +609,7 @@ extern int char_index(internal_font_number f, int c);
 scaled raw_get_kern(internal_font_number f, int lc, int rc);
 scaled get_kern(internal_font_number f, int lc, int rc);
 liginfo get_ligature(internal_font_number f, int lc, int rc);
+scaled_whd *get_metric_cache(internal_font_number f);
 
 #  define EXT_TOP 0
 #  define EXT_BOT 1
@@ -593,6 +617,7 @@ liginfo get_ligature(internal_font_number f, int lc, int rc);
 #  define EXT_REP 3
 
 extern texfont **font_tables;
+extern int font_generation;
 
 int new_font(void);
 extern void font_malloc_charinfo(internal_font_number f, int num);
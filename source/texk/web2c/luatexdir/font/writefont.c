@@ -693,9 +693,11 @@ static void write_fontdictionaries(PDF pdf)
 
 void write_fontstuff(PDF pdf)
 {
+    phase_timer_start(fonts_timer);
     write_fontdescriptors(pdf);
     write_fontencodings(pdf);
     write_fontdictionaries(pdf);
+    phase_timer_stop(fonts_timer);
 }
 
 static void create_fontdictionary(PDF pdf, internal_font_number f)
@@ -274,6 +274,7 @@ void read_img(image_dict * idict)
     check_type_by_header(idict);
     check_type_by_extension(idict);
     /*tex Now we're ready to read the image. */
+    phase_timer_start(images_timer);
     switch (img_type(idict)) {
         case IMG_TYPE_PDFMEMSTREAM:
         case IMG_TYPE_PDF:
@@ -300,6 +301,7 @@ void read_img(image_dict * idict)
             }
             break;
     }
+    phase_timer_stop(images_timer);
     cur_file_name = NULL;
     if (img_type(idict) == IMG_TYPE_NONE) {
         img_state(idict) = DICT_NEW;
@@ -610,6 +612,7 @@ scaled_whd scale_img(image_dict * idict, scaled_whd alt_rule, int transform)
 
 void write_img(PDF pdf, image_dict * idict)
 {
+    phase_timer_start(images_timer);
     if (img_state(idict) < DICT_WRITTEN) {
         report_start_file(filetype_image, img_filepath(idict));
         switch (img_type(idict)) {
@@ -642,6 +645,7 @@ void write_img(PDF pdf, image_dict * idict)
     }
     if (img_state(idict) < DICT_WRITTEN)
         img_state(idict) = DICT_WRITTEN;
+    phase_timer_stop(images_timer);
 }
 
 int write_img_object(PDF pdf, image_dict * idict, int n)
@@ -53,7 +53,7 @@ struct tex_language *new_language(int n)
         lang = xmalloc(sizeof(struct tex_language));
         tex_languages[l] = lang;
         lang->id = (int) l;
-        lang->exceptions = 0;
+        lang->exceptions = NULL;
         lang->patterns = NULL;
         lang->pre_hyphen_char = '-';
         lang->post_hyphen_char = 0;
@@ -205,8 +205,8 @@ const char *clean_hyphenation(int id, const char *buff, char **cleaned)
     int items = 0;
     /*tex Work buffer for bytes: */
     unsigned char word[MAX_WORD_LEN + 1];
-    /*tex Work buffer for \UNICODE: */
-    unsigned uword[MAX_WORD_LEN + 1] = { 0 };
+    /*tex Work buffer for \UNICODE, terminated by |utf2uni_strcpy|: */
+    unsigned uword[MAX_WORD_LEN + 1];
     /*tex The \UNICODE\ buffer value: */
     int u = 0;
     /*tex The index into buffer: */
@@ -279,6 +279,94 @@ const char *clean_hyphenation(int id, const char *buff, char **cleaned)
     return s;
 }
 
+/*tex
+
+    The exceptions of a language are kept in a hash table that maps a cleaned
+    word onto its specification. The entries are kept in the order in which they
+    are defined and a redefinition of a word replaces its specification.
+
+*/
+
+static unsigned exception_hash(const char *w)
+{
+    unsigned h = 2166136261U;
+    while (*w) {
+        h = (h ^ (unsigned char) *w++) * 16777619U;
+    }
+    return h;
+}
+
+static hyph_exceptions *new_exceptions(void)
+{
+    hyph_exceptions *e = xmalloc(sizeof(hyph_exceptions));
+    e->count = 0;
+    e->size = 0;
+    e->mask = -1;
+    e->buckets = NULL;
+    e->entries = NULL;
+    return e;
+}
+
+static void free_exceptions(hyph_exceptions *e)
+{
+    int i;
+    for (i = 0; i < e->count; i++) {
+        free(e->entries[i].word);
+        free(e->entries[i].value);
+    }
+    xfree(e->entries);
+    xfree(e->buckets);
+    free(e);
+}
+
+static hyph_exception *find_exception(hyph_exceptions *e, const char *w, unsigned h)
+{
+    if (e->count > 0) {
+        int i = e->buckets[h & (unsigned) e->mask];
+        while (i >= 0) {
+            hyph_exception *x = &e->entries[i];
+            if (x->hash == h && strcmp(x->word, w) == 0)
+                return x;
+            i = x->next;
+        }
+    }
+    return NULL;
+}
+
+/*tex The |word| and |value| become the property of the table. */
+
+static void add_exception(hyph_exceptions *e, char *word, char *value)
+{
+    unsigned h = exception_hash(word);
+    hyph_exception *x = find_exception(e, word, h);
+    if (x != NULL) {
+        free(word);
+        free(x->value);
+        x->value = value;
+        return;
+    }
+    if (e->count == e->size) {
+        int i;
+        e->size = (e->size == 0 ? 64 : 2 * e->size);
+        e->entries = xrealloc(e->entries, (unsigned) e->size * sizeof(hyph_exception));
+        e->buckets = xrealloc(e->buckets, (unsigned) e->size * sizeof(int));
+        e->mask = e->size - 1;
+        for (i = 0; i < e->size; i++)
+            e->buckets[i] = -1;
+        for (i = 0; i < e->count; i++) {
+            unsigned b = e->entries[i].hash & (unsigned) e->mask;
+            e->entries[i].next = e->buckets[b];
+            e->buckets[b] = i;
+        }
+    }
+    x = &e->entries[e->count];
+    x->word = word;
+    x->value = value;
+    x->hash = h;
+    x->next = e->buckets[h & (unsigned) e->mask];
+    e->buckets[h & (unsigned) e->mask] = e->count++;
+}
+
 void load_hyphenation(struct tex_language *lang, const unsigned char *buff)
 {
     const char *s;
@@ -287,11 +375,9 @@ void load_hyphenation(struct tex_language *lang, const unsigned char *buff)
     int id ;
     if (lang == NULL)
         return;
-    if (lang->exceptions == 0) {
-        lua_newtable(Luas);
-        lang->exceptions = luaL_ref(Luas, LUA_REGISTRYINDEX);
+    if (lang->exceptions == NULL) {
+        lang->exceptions = new_exceptions();
     }
-    lua_rawgeti(Luas, LUA_REGISTRYINDEX, lang->exceptions);
     s = (const char *) buff;
     id = lang->id;
     while (*s) {
@@ -302,11 +388,13 @@ void load_hyphenation(struct tex_language *lang, const unsigned char *buff)
             s = clean_hyphenation(id, s, &cleaned);
             if (cleaned != NULL) {
                 if ((s - value) > 0) {
-                    lua_pushstring(Luas, cleaned);
-                    lua_pushlstring(Luas, value, (size_t) (s - value));
-                    lua_rawset(Luas, -3);
+                    char *v = xmalloc((unsigned) (s - value + 1));
+                    memcpy(v, value, (size_t) (s - value));
+                    v[s - value] = '\0';
+                    add_exception(lang->exceptions, cleaned, v);
+                } else {
+                    free(cleaned);
                 }
-                free(cleaned);
             } else {
 #ifdef VERBOSE
                 formatted_warning("hyphenation","skipping invalid hyphenation exception: %s", value);
@@ -320,9 +408,9 @@ void clear_hyphenation(struct tex_language *lang)
 {
     if (lang == NULL)
         return;
-    if (lang->exceptions != 0) {
-        luaL_unref(Luas, LUA_REGISTRYINDEX, lang->exceptions);
-        lang->exceptions = 0;
+    if (lang->exceptions != NULL) {
+        free_exceptions(lang->exceptions);
+        lang->exceptions = NULL;
     }
 }
 
@@ -483,49 +571,30 @@ void set_disc_field(halfword f, halfword t)
     }
 }
 
-static char *hyphenation_exception(int exceptions, char *w)
+static const char *hyphenation_exception(hyph_exceptions *exceptions, const char *w)
 {
-    char *ret = NULL;
-    lua_checkstack(Luas, 2);
-    lua_rawgeti(Luas, LUA_REGISTRYINDEX, exceptions);
-    if (lua_istable(Luas, -1)) {
-        /*tex Word table: */
-        lua_pushstring(Luas, w);
-        lua_rawget(Luas, -2);
-        if (lua_type(Luas, -1) == LUA_TSTRING) {
-            ret = xstrdup(lua_tostring(Luas, -1));
-        }
-        lua_pop(Luas, 2);
-    } else {
-        lua_pop(Luas, 1);
-    }
-    return ret;
+    hyph_exception *x = find_exception(exceptions, w, exception_hash(w));
+    return (x != NULL ? x->value : NULL);
 }
 
 char *exception_strings(struct tex_language *lang)
 {
-    const char *value;
     size_t size = 0, current = 0;
-    size_t l = 0;
     char *ret = NULL;
-    if (lang->exceptions == 0)
+    int i;
+    if (lang->exceptions == NULL)
         return NULL;
-    lua_checkstack(Luas, 2);
-    lua_rawgeti(Luas, LUA_REGISTRYINDEX, lang->exceptions);
-    if (lua_istable(Luas, -1)) {
-        /*tex Iterate and join. */
-        lua_pushnil(Luas);
-        while (lua_next(Luas, -2) != 0) {
-            value = lua_tolstring(Luas, -1, &l);
-            if (current + 2 + l > size) {
-                ret = xrealloc(ret, (unsigned) ((size + size / 5) + current + l + 1024));
-                size = (size + size / 5) + current + l + 1024;
-            }
-            *(ret + current) = ' ';
-            strcpy(ret + current + 1, value);
-            current += l + 1;
-            lua_pop(Luas, 1);
+    /*tex Join the specifications. */
+    for (i = 0; i < lang->exceptions->count; i++) {
+        const char *value = lang->exceptions->entries[i].value;
+        size_t l = strlen(value);
+        if (current + 2 + l > size) {
+            ret = xrealloc(ret, (unsigned) ((size + size / 5) + current + l + 1024));
+            size = (size + size / 5) + current + l + 1024;
         }
+        *(ret + current) = ' ';
+        strcpy(ret + current + 1, value);
+        current += l + 1;
     }
     return ret;
 }
@@ -593,14 +662,14 @@ static const char *PAT_ERROR[] = {
 
 */
 
-static void do_exception(halfword wordstart, halfword r, char *replacement)
+static void do_exception(halfword wordstart, halfword r, const char *replacement)
 {
     unsigned i;
     halfword t, pen;
     unsigned len;
     int clang;
     lang_variables langdata;
-    unsigned uword[MAX_WORD_LEN + 1] = { 0 };
+    unsigned uword[MAX_WORD_LEN + 1];
     utf2uni_strcpy(uword, replacement);
     len = u_length(uword);
     i = 0;
@@ -946,10 +1015,15 @@ void hnj_hyphenation(halfword head, halfword tail)
     int lchar, i;
     struct tex_language *lang;
     lang_variables langdata;
-    char utf8word[(4 * MAX_WORD_LEN) + 1] = { 0 };
+    /*tex
+        This buffer is large, so we don't clear it: this function runs for every
+        packaged list, for instance for every cell of an alignment, and the word
+        gets terminated before it is used.
+    */
+    char utf8word[(4 * MAX_WORD_LEN) + 1];
     int wordlen = 0;
     char *hy = utf8word;
-    char *replacement = NULL;
+    const char *replacement = NULL;
     boolean explicit_hyphen = false;
     boolean valid_word = false;
     halfword first_language = first_valid_language_par;
@@ -1103,14 +1177,13 @@ void hnj_hyphenation(halfword head, halfword tail)
                 this is messy and nasty: we can have a word with a - in it which
                 is why we have two branches
             */
-            if (lang->exceptions != 0 && (replacement = hyphenation_exception(lang->exceptions, utf8word)) != NULL) {
+            if (lang->exceptions != NULL && (replacement = hyphenation_exception(lang->exceptions, utf8word)) != NULL) {
                 /*tex handle the exception and go on to the next word */
                 if (expstart == null) {
                     do_exception(wordstart, r, replacement);
                 } else {
                     do_exception(expstart,r,replacement);
                 }
-                free(replacement);
             } else if (expstart != null) {
                 /*tex We're done already */
             } else if (lang->patterns != NULL) {
@@ -1234,11 +1307,21 @@ static void dump_one_language(int i)
         free(s);
         s = NULL;
     }
-    if (lang->exceptions != 0)
-        s = exception_strings(lang);
-    dump_string(s);
-    if (s != NULL) {
-        free(s);
+    /*tex
+        The exceptions are dumped as pairs of cleaned word and specification,
+        so that loading them doesn't need cleaning.
+    */
+    if (lang->exceptions != NULL) {
+        hyph_exceptions *e = lang->exceptions;
+        int k;
+        dump_int(e->count);
+        for (k = 0; k < e->count; k++) {
+            dump_string(e->entries[k].word);
+            dump_string(e->entries[k].value);
+        }
+        free_exceptions(e);
+    } else {
+        dump_int(0);
     }
     free(lang);
 }
@@ -1285,10 +1368,18 @@ static void undump_one_language(int i)
     /*tex exceptions */
     undump_int(x);
     if (x > 0) {
-        s = xmalloc((unsigned) x);
-        undump_things(*s, x);
-        load_hyphenation(lang, (unsigned char *) s);
-        free(s);
+        int n = x;
+        lang->exceptions = new_exceptions();
+        while (n-- > 0) {
+            char *w, *v;
+            undump_int(x);
+            w = xmalloc((unsigned) x);
+            undump_things(*w, x);
+            undump_int(x);
+            v = xmalloc((unsigned) x);
+            undump_things(*v, x);
+            add_exception(lang->exceptions, w, v);
+        }
     }
 }
 
@@ -29,9 +29,24 @@ typedef struct _lang_variables {
 
 #  include "lang/hyphen.h"
 
+typedef struct hyph_exception {
+    char *word;                 /* the cleaned word */
+    char *value;                /* the specification */
+    unsigned hash;
+    int next;                   /* next entry in the same bucket */
+} hyph_exception;
+
+typedef struct hyph_exceptions {
+    int count;
+    int size;
+    int mask;                   /* number of buckets minus one */
+    int *buckets;
+    hyph_exception *entries;    /* in order of definition */
+} hyph_exceptions;
+
 struct tex_language {
     HyphenDict *patterns;
-    int exceptions;             /* lua registry pointer, should be replaced */
+    hyph_exceptions *exceptions;
     int id;
     int pre_hyphen_char;
     int post_hyphen_char;
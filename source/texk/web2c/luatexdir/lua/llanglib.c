@@ -94,8 +94,10 @@ static int lang_hyphenation(lua_State * L)
         load_hyphenation(*lang_ptr, (const unsigned char *) lua_tostring(L, 2));
         return 0;
     } else {
-        if ((*lang_ptr)->exceptions != 0) {
-            lua_pushstring(L, exception_strings(*lang_ptr));
+        if ((*lang_ptr)->exceptions != NULL) {
+            char *s = exception_strings(*lang_ptr);
+            lua_pushstring(L, s);
+            free(s);
         } else {
             lua_pushnil(L);
         }
@@ -148,7 +148,11 @@
     }                                           \
 } while (0)
 
-#define nodelib_setattr(L, s, n)     reassign_attribute(n,nodelib_getlist(L,s))
+#define nodelib_setattr(L, s, n) do { \
+    halfword a_ = nodelib_getlist(L,s);  \
+    expose_attribute_list(a_);           \
+    reassign_attribute(n,a_);            \
+} while (0)
 
 #define nodelib_gettoks(L,a)   tokenlist_from_lua(L)
 
@@ -818,6 +822,7 @@ static int lua_nodelib_direct_getattributelist(lua_State * L)
 {
     halfword n = lua_tointeger(L, 1);
     if ((n) && nodetype_has_attributes(type(n)) && node_attr(n) != null) {
+        expose_attribute_list(node_attr(n));
         lua_pushinteger(L, node_attr(n));
     } else {
         lua_pushnil(L);
@@ -833,6 +838,7 @@ static int lua_nodelib_direct_setattributelist(lua_State * L)
         if (t == LUA_TNUMBER) {
             halfword a =lua_tointeger(L, 2);
             if (type(a) == attribute_list_node) {
+                expose_attribute_list(a);
                 reassign_attribute(n,a);
             } else if (nodetype_has_attributes(type(a))) {
                 reassign_attribute(n,node_attr(a));
@@ -1176,6 +1182,454 @@ static int lua_nodelib_direct_setoffsets(lua_State * L)
     return 0;
 }
 
+/* node.direct.getlistfields */
+/* node.direct.setlistfields */
+
+/*
+    Shaping and spacing code often needs a few fields of every node in a range
+    of a list. Instead of calling a getter per node per field one can fetch them
+    in one go into (preallocated) arrays:
+
+        local t = { node = { }, id = { }, char = { }, font = { } }
+        local n = node.direct.getlistfields(first,last,t)
+
+    The range is inclusive and runs till the end of the list when there is no
+    last node. Only the arrays that are present get filled. Supported are node,
+    id, subtype, char, font, width, xoffset, yoffset and attr, where the last
+    one gets the value of the attribute passed as fourth argument. Entries that
+    don't apply to a node become false. The setter takes the same arguments and
+    sets subtype, char, font, width, xoffset, yoffset and attr when the entry is
+    a number; for attr false unsets the attribute. The number of visited nodes
+    is returned.
+*/
+
+#define list_field_node     0
+#define list_field_id       1
+#define list_field_subtype  2
+#define list_field_char     3
+#define list_field_font     4
+#define list_field_width    5
+#define list_field_xoffset  6
+#define list_field_yoffset  7
+#define list_field_attr     8
+#define list_field_max      9
+
+static const char *list_field_names[] = {
+    "node", "id", "subtype", "char", "font", "width", "xoffset", "yoffset", "attr", NULL
+};
+
+/* we collect the arrays on the stack and return the first slot (or zero) */
+
+static int list_field_arrays(lua_State * L, int t, int *slots)
+{
+    int i;
+    int top = lua_gettop(L);
+    for (i = 0; i < list_field_max; i++) {
+        lua_getfield(L, t, list_field_names[i]);
+        if (lua_type(L, -1) == LUA_TTABLE) {
+            slots[i] = lua_gettop(L);
+        } else {
+            lua_pop(L, 1);
+            slots[i] = 0;
+        }
+    }
+    return top;
+}
+
+static int lua_nodelib_direct_getlistfields(lua_State * L)
+{
+    int slots[list_field_max];
+    int top, i = 0;
+    halfword n = lua_tointeger(L, 1);
+    halfword last = lua_tointeger(L, 2);
+    int a = lua_tointeger(L, 4);
+    luaL_checktype(L, 3, LUA_TTABLE);
+    top = list_field_arrays(L, 3, slots);
+    while (n != null) {
+        halfword t = type(n);
+        i++;
+        if (slots[list_field_node]) {
+            lua_pushinteger(L, n);
+            lua_rawseti(L, slots[list_field_node], i);
+        }
+        if (slots[list_field_id]) {
+            lua_pushinteger(L, t);
+            lua_rawseti(L, slots[list_field_id], i);
+        }
+        if (slots[list_field_subtype]) {
+            lua_pushinteger(L, subtype(n));
+            lua_rawseti(L, slots[list_field_subtype], i);
+        }
+        if (slots[list_field_char]) {
+            if (t == glyph_node)
+                lua_pushinteger(L, character(n));
+            else
+                lua_pushboolean(L, 0);
+            lua_rawseti(L, slots[list_field_char], i);
+        }
+        if (slots[list_field_font]) {
+            if (t == glyph_node)
+                lua_pushinteger(L, font(n));
+            else
+                lua_pushboolean(L, 0);
+            lua_rawseti(L, slots[list_field_font], i);
+        }
+        if (slots[list_field_width]) {
+            if (t == glyph_node) {
+                lua_pushinteger(L, char_width(font(n),character(n)));
+            } else if (t == hlist_node || t == vlist_node || t == rule_node || t == glue_node || t == math_node ||
+                    t == kern_node || t == margin_kern_node || t == ins_node || t == unset_node) {
+                lua_pushinteger(L, width(n));
+            } else {
+                lua_pushboolean(L, 0);
+            }
+            lua_rawseti(L, slots[list_field_width], i);
+        }
+        if (slots[list_field_xoffset]) {
+            if (t == glyph_node)
+                lua_pushinteger(L, x_displace(n));
+            else if (t == rule_node)
+                lua_pushinteger(L, rule_left(n));
+            else
+                lua_pushboolean(L, 0);
+            lua_rawseti(L, slots[list_field_xoffset], i);
+        }
+        if (slots[list_field_yoffset]) {
+            if (t == glyph_node)
+                lua_pushinteger(L, y_displace(n));
+            else if (t == rule_node)
+                lua_pushinteger(L, rule_right(n));
+            else
+                lua_pushboolean(L, 0);
+            lua_rawseti(L, slots[list_field_yoffset], i);
+        }
+        if (slots[list_field_attr]) {
+            int v = has_attribute(n, a, UNUSED_ATTRIBUTE);
+            if (v != UNUSED_ATTRIBUTE)
+                lua_pushinteger(L, v);
+            else
+                lua_pushboolean(L, 0);
+            lua_rawseti(L, slots[list_field_attr], i);
+        }
+        if (n == last)
+            break;
+        n = vlink(n);
+    }
+    lua_settop(L, top);
+    lua_pushinteger(L, i);
+    return 1;
+}
+
+static int lua_nodelib_direct_setlistfields(lua_State * L)
+{
+    int slots[list_field_max];
+    int top, i = 0;
+    halfword n = lua_tointeger(L, 1);
+    halfword last = lua_tointeger(L, 2);
+    int a = lua_tointeger(L, 4);
+    luaL_checktype(L, 3, LUA_TTABLE);
+    top = list_field_arrays(L, 3, slots);
+    while (n != null) {
+        halfword t = type(n);
+        i++;
+        if (slots[list_field_subtype]) {
+            lua_rawgeti(L, slots[list_field_subtype], i);
+            if (lua_type(L, -1) == LUA_TNUMBER)
+                subtype(n) = (quarterword) lua_tointeger(L, -1);
+            lua_pop(L, 1);
+        }
+        if (t == glyph_node) {
+            if (slots[list_field_char]) {
+                lua_rawgeti(L, slots[list_field_char], i);
+                if (lua_type(L, -1) == LUA_TNUMBER)
+                    character(n) = (halfword) lua_tointeger(L, -1);
+                lua_pop(L, 1);
+            }
+            if (slots[list_field_font]) {
+                lua_rawgeti(L, slots[list_field_font], i);
+                if (lua_type(L, -1) == LUA_TNUMBER)
+                    font(n) = (halfword) lua_tointeger(L, -1);
+                lua_pop(L, 1);
+            }
+        }
+        if (slots[list_field_width] && t != glyph_node) {
+            if (t == hlist_node || t == vlist_node || t == rule_node || t == glue_node || t == math_node ||
+                    t == kern_node || t == margin_kern_node || t == ins_node || t == unset_node) {
+                lua_rawgeti(L, slots[list_field_width], i);
+                if (lua_type(L, -1) == LUA_TNUMBER)
+                    width(n) = (halfword) lua_roundnumber(L, -1);
+                lua_pop(L, 1);
+            }
+        }
+        if (t == glyph_node || t == rule_node) {
+            if (slots[list_field_xoffset]) {
+                lua_rawgeti(L, slots[list_field_xoffset], i);
+                if (lua_type(L, -1) == LUA_TNUMBER) {
+                    if (t == glyph_node)
+                        x_displace(n) = (halfword) lua_roundnumber(L, -1);
+                    else
+                        rule_left(n) = (halfword) lua_roundnumber(L, -1);
+                }
+                lua_pop(L, 1);
+            }
+            if (slots[list_field_yoffset]) {
+                lua_rawgeti(L, slots[list_field_yoffset], i);
+                if (lua_type(L, -1) == LUA_TNUMBER) {
+                    if (t == glyph_node)
+                        y_displace(n) = (halfword) lua_roundnumber(L, -1);
+                    else
+                        rule_right(n) = (halfword) lua_roundnumber(L, -1);
+                }
+                lua_pop(L, 1);
+            }
+        }
+        if (slots[list_field_attr] && nodetype_has_attributes(t)) {
+            lua_rawgeti(L, slots[list_field_attr], i);
+            if (lua_type(L, -1) == LUA_TNUMBER) {
+                int v = (int) lua_tointeger(L, -1);
+                if (v != has_attribute(n, a, UNUSED_ATTRIBUTE))
+                    set_attribute(n, a, v);
+            } else if (lua_type(L, -1) == LUA_TBOOLEAN && has_attribute(n, a, UNUSED_ATTRIBUTE) != UNUSED_ATTRIBUTE) {
+                (void) unset_attribute(n, a, UNUSED_ATTRIBUTE);
+            }
+            lua_pop(L, 1);
+        }
+        if (n == last)
+            break;
+        n = vlink(n);
+    }
+    lua_settop(L, top);
+    lua_pushinteger(L, i);
+    return 1;
+}
+
+/* node.direct.memorylayout */
+/* node.direct.checknode */
+
+/*tex
+
+    The memory layout of the most used nodes can be consulted, so that |ffi| code
+    in \LUAJITTEX\ can access fields directly:
+
+    \starttyping
+    local m = node.direct.memorylayout()
+    local w = ffi.cast("char*",m.pointer) + n * m.wordsize
+    local f = m.fields[node.id("glyph")].char
+    local c = ffi.cast("int*",w + f[1] * m.wordsize + m.parts[f[2]])[0]
+    \stoptyping
+
+    The pointer changes when node memory grows, which is reflected in the
+    |generation| field. The |version| field is incremented when fields move.
+    A field only gets the name of a |getfield| key when it holds the same value,
+    so the word with the packed language data of a glyph is |lang_data| and the
+    disc words with the head nodes of the three lists are |pre_head| and so on.
+    Checked accessors can use |checknode| which raises an error when a node is
+    not allocated, not of the given type, or too small for a given word offset.
+
+*/
+
+typedef enum {
+    layout_info,
+    layout_link,
+    layout_type,
+    layout_subtype,
+    layout_int,
+    layout_ratio,
+} layout_parts;
+
+static const char *layout_part_names[] = {
+    "info", "link", "type", "subtype", "int", "ratio",
+};
+
+typedef struct {
+    int id;
+    const char *name;
+    int word;
+    int part;
+} layout_field;
+
+#define layout_end { -1, NULL, 0, 0 }
+
+static const layout_field layout_fields[] = {
+    { glyph_node,     "char",         2, layout_info },
+    { glyph_node,     "font",         2, layout_link },
+    { glyph_node,     "lang_data",    3, layout_info },
+    { glyph_node,     "components",   3, layout_link },
+    { glyph_node,     "xoffset",      4, layout_info },
+    { glyph_node,     "yoffset",      4, layout_link },
+    { glyph_node,     "expansion",    5, layout_info },
+    { glyph_node,     "data",         5, layout_link },
+    { hlist_node,     "width",        2, layout_int },
+    { hlist_node,     "depth",        3, layout_int },
+    { hlist_node,     "height",       4, layout_int },
+    { hlist_node,     "dir",          5, layout_info },
+    { hlist_node,     "shift",        5, layout_link },
+    { hlist_node,     "glue_sign",    6, layout_type },
+    { hlist_node,     "glue_order",   6, layout_subtype },
+    { hlist_node,     "list",         6, layout_link },
+    { hlist_node,     "glue_set",     7, layout_ratio },
+    { rule_node,      "width",        2, layout_int },
+    { rule_node,      "depth",        3, layout_int },
+    { rule_node,      "height",       4, layout_int },
+    { rule_node,      "dir",          5, layout_link },
+    { rule_node,      "index",        6, layout_info },
+    { rule_node,      "transform",    6, layout_link },
+    { rule_node,      "left",         7, layout_info },
+    { rule_node,      "right",        7, layout_link },
+    { glue_node,      "width",        2, layout_int },
+    { glue_node,      "shrink",       3, layout_info },
+    { glue_node,      "stretch",      3, layout_link },
+    { glue_node,      "stretch_order",4, layout_info },
+    { glue_node,      "shrink_order", 4, layout_link },
+    { glue_node,      "leader",       5, layout_link },
+    { glue_spec_node, "width",        2, layout_int },
+    { glue_spec_node, "shrink",       3, layout_info },
+    { glue_spec_node, "stretch",      3, layout_link },
+    { glue_spec_node, "stretch_order",4, layout_info },
+    { glue_spec_node, "shrink_order", 4, layout_link },
+    { kern_node,      "kern",         2, layout_int },
+    { kern_node,      "expansion",    3, layout_info },
+    { penalty_node,   "penalty",      2, layout_link },
+    { math_node,      "width",        2, layout_int },
+    { math_node,      "shrink",       3, layout_info },
+    { math_node,      "stretch",      3, layout_link },
+    { math_node,      "stretch_order",4, layout_info },
+    { math_node,      "shrink_order", 4, layout_link },
+    { math_node,      "surround",     5, layout_info },
+    { disc_node,      "penalty",      2, layout_link },
+    { disc_node,      "pre_head",     3, layout_info },
+    { disc_node,      "post_head",    3, layout_link },
+    { disc_node,      "replace_head", 4, layout_link },
+    layout_end
+};
+
+static void layout_push_field(lua_State * L, const char *name, int word, int part)
+{
+    lua_createtable(L, 2, 0);
+    lua_pushinteger(L, word);
+    lua_rawseti(L, -2, 1);
+    lua_pushstring(L, layout_part_names[part]);
+    lua_rawseti(L, -2, 2);
+    lua_setfield(L, -2, name);
+}
+
+static void layout_push_type(lua_State * L, int id, int size)
+{
+    const layout_field *f;
+    int n = (id == hlist_node ? vlist_node : id);
+    lua_newtable(L);
+    lua_pushinteger(L, size);
+    lua_setfield(L, -2, "size");
+    layout_push_field(L, "next", 0, layout_link);
+    layout_push_field(L, "id", 0, layout_type);
+    layout_push_field(L, "subtype", 0, layout_subtype);
+    if (nodetype_has_attributes(id)) {
+        layout_push_field(L, "attr", 1, layout_info);
+        layout_push_field(L, "prev", 1, layout_link);
+    }
+    for (f = layout_fields; f->name != NULL; f++) {
+        if (f->id == id) {
+            layout_push_field(L, f->name, f->word, f->part);
+        }
+    }
+    if (n != id) {
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, n);
+    }
+    lua_rawseti(L, -2, id);
+}
+
+static int lua_nodelib_direct_memorylayout(lua_State * L)
+{
+    int i;
+    lua_newtable(L);
+    lua_pushinteger(L, node_memory_layout_version);
+    lua_setfield(L, -2, "version");
+    lua_pushinteger(L, varmem_generation);
+    lua_setfield(L, -2, "generation");
+    lua_pushlightuserdata(L, (void *) &varmem_generation);
+    lua_setfield(L, -2, "generationpointer");
+    lua_pushlightuserdata(L, (void *) varmem);
+    lua_setfield(L, -2, "pointer");
+    lua_pushlightuserdata(L, (void *) varmem_sizes);
+    lua_setfield(L, -2, "sizes");
+    lua_pushinteger(L, var_mem_max);
+    lua_setfield(L, -2, "size");
+    lua_pushinteger(L, (int) sizeof(memory_word));
+    lua_setfield(L, -2, "wordsize");
+    /*tex The byte offsets of the parts of a memory word. */
+    lua_newtable(L);
+    lua_pushinteger(L, (int) offsetof(memory_word, hh.v.LH));
+    lua_setfield(L, -2, layout_part_names[layout_info]);
+    lua_pushinteger(L, (int) offsetof(memory_word, hh.v.RH));
+    lua_setfield(L, -2, layout_part_names[layout_link]);
+    lua_pushinteger(L, (int) offsetof(memory_word, hh.u.B0));
+    lua_setfield(L, -2, layout_part_names[layout_type]);
+    lua_pushinteger(L, (int) offsetof(memory_word, hh.u.B1));
+    lua_setfield(L, -2, layout_part_names[layout_subtype]);
+    lua_pushinteger(L, (int) offsetof(memory_word, ii.CINT0));
+    lua_setfield(L, -2, layout_part_names[layout_int]);
+    lua_pushinteger(L, (int) offsetof(memory_word, gg.GLUE));
+    lua_setfield(L, -2, layout_part_names[layout_ratio]);
+    lua_setfield(L, -2, "parts");
+    /*tex The sizes of the parts in bytes. */
+    lua_newtable(L);
+    for (i = layout_info; i <= layout_ratio; i++) {
+        int s = (int) sizeof(halfword);
+        if (i == layout_type || i == layout_subtype) {
+            s = (int) sizeof(quarterword);
+        } else if (i == layout_ratio) {
+            s = (int) sizeof(glue_ratio);
+        }
+        lua_pushinteger(L, s);
+        lua_setfield(L, -2, layout_part_names[i]);
+    }
+    lua_setfield(L, -2, "partsizes");
+    /*tex The fields per node type, indexed by id. */
+    lua_newtable(L);
+    layout_push_type(L, glyph_node, glyph_node_size);
+    layout_push_type(L, hlist_node, box_node_size);
+    layout_push_type(L, rule_node, rule_node_size);
+    layout_push_type(L, glue_node, glue_node_size);
+    layout_push_type(L, glue_spec_node, glue_spec_size);
+    layout_push_type(L, kern_node, kern_node_size);
+    layout_push_type(L, penalty_node, penalty_node_size);
+    layout_push_type(L, math_node, math_node_size);
+    layout_push_type(L, disc_node, disc_node_size);
+    lua_setfield(L, -2, "fields");
+    return 1;
+}
+
+/*tex A cheap way to find out if pointers from |memorylayout| are still valid. */
+
+static int lua_nodelib_direct_memorygeneration(lua_State * L)
+{
+    lua_pushinteger(L, varmem_generation);
+    return 1;
+}
+
+static int lua_nodelib_direct_checknode(lua_State * L)
+{
+    halfword n = (halfword) lua_tointeger(L, 1);
+    if (! valid_node(n)) {
+        return luaL_error(L, "node %d is not an allocated node", (int) n);
+    }
+    if (lua_type(L, 2) == LUA_TNUMBER) {
+        int id = (int) lua_tointeger(L, 2);
+        if (type(n) != id) {
+            return luaL_error(L, "node %d has id %d instead of %d", (int) n, (int) type(n), id);
+        }
+    }
+    if (lua_type(L, 3) == LUA_TNUMBER) {
+        int w = (int) lua_tointeger(L, 3);
+        if (w < 0 || w >= varmem_sizes[n]) {
+            return luaL_error(L, "word %d is outside node %d of size %d", w, (int) n, (int) varmem_sizes[n]);
+        }
+    }
+    lua_pushinteger(L, n);
+    return 1;
+}
+
 /* node.direct.getdisc */
 /* node.direct.setdisc */
 
@@ -3371,27 +3825,11 @@ static int lua_nodelib_get_attribute(lua_State * L)
     halfword p = *check_isnode(L, 1);
     if (nodetype_has_attributes(type(p))) {
         p = node_attr(p);
-        if (p != null) {
-            p = vlink(p);
-            if (p != null) {
-                int i = 0;
-                if (lua_gettop(L) > 1) {
-                    i = lua_tointeger(L, 2);
-                }
-                while (p != null) {
-                    if (attribute_id(p) == i) {
-                        int ret = attribute_value(p);
-                        if (ret == UNUSED_ATTRIBUTE) {
-                            break;
-                        } else {
-                            lua_pushinteger(L,ret);
-                            return 1;
-                        }
-                    } else if (attribute_id(p) > i) {
-                        break;
-                    }
-                    p = vlink(p);
-                }
+        if (p != null && vlink(p) != null) {
+            int ret = attribute_list_value(p, lua_gettop(L) > 1 ? (int) lua_tointeger(L, 2) : 0);
+            if (ret != UNUSED_ATTRIBUTE) {
+                lua_pushinteger(L,ret);
+                return 1;
             }
         }
     }
@@ -3408,21 +3846,11 @@ static int lua_nodelib_find_attribute(lua_State * L) /* returns attr value and n
         if (nodetype_has_attributes(type(c))) {
             p = node_attr(c);
             if (p != null) {
-                p = vlink(p);
-                while (p != null) {
-                    if (attribute_id(p) == i) {
-                        int ret = attribute_value(p);
-                        if (ret == UNUSED_ATTRIBUTE) {
-                            break;
-                        } else {
-                            lua_pushinteger(L,ret);
-                            lua_nodelib_push_fast(L, c  );
-                            return 2;
-                        }
-                    } else if (attribute_id(p) > i) {
-                        break;
-                    }
-                    p = vlink(p);
+                int ret = attribute_list_value(p, i);
+                if (ret != UNUSED_ATTRIBUTE) {
+                    lua_pushinteger(L,ret);
+                    lua_nodelib_push_fast(L, c  );
+                    return 2;
                 }
             }
         }
@@ -3446,27 +3874,11 @@ static int lua_nodelib_direct_get_attribute(lua_State * L)
     register halfword p = lua_tointeger(L, 1);
     if (nodetype_has_attributes(type(p))) {
         p = node_attr(p);
-        if (p != null) {
-            p = vlink(p);
-            if (p != null) {
-                int i = 0;
-                if (lua_gettop(L) > 1) {
-                    i = lua_tointeger(L, 2);
-                }
-                while (p != null) {
-                    if (attribute_id(p) == i) {
-                        int ret = attribute_value(p);
-                        if (ret == UNUSED_ATTRIBUTE) {
-                            break;
-                        } else {
-                            lua_pushinteger(L,ret);
-                            return 1;
-                        }
-                    } else if (attribute_id(p) > i) {
-                        break;
-                    }
-                    p = vlink(p);
-                }
+        if (p != null && vlink(p) != null) {
+            int ret = attribute_list_value(p, lua_gettop(L) > 1 ? (int) lua_tointeger(L, 2) : 0);
+            if (ret != UNUSED_ATTRIBUTE) {
+                lua_pushinteger(L,ret);
+                return 1;
             }
         }
     }
@@ -3503,21 +3915,11 @@ static int lua_nodelib_direct_find_attribute(lua_State * L) /* returns attr valu
         if (nodetype_has_attributes(type(c))) {
             p = node_attr(c);
             if (p != null) {
-                p = vlink(p);
-                while (p != null) {
-                    if (attribute_id(p) == i) {
-                        int ret = attribute_value(p);
-                        if (ret == UNUSED_ATTRIBUTE) {
-                            break;
-                        } else {
-                            lua_pushinteger(L,ret);
-                            lua_pushinteger(L,c);
-                            return 2;
-                        }
-                    } else if (attribute_id(p) > i) {
-                        break;
-                    }
-                    p = vlink(p);
+                int ret = attribute_list_value(p, i);
+                if (ret != UNUSED_ATTRIBUTE) {
+                    lua_pushinteger(L,ret);
+                    lua_pushinteger(L,c);
+                    return 2;
                 }
             }
         }
@@ -4682,6 +5084,7 @@ static int lua_nodelib_fast_getfield(lua_State * L)
         if (! nodetype_has_attributes(t)) {
             lua_pushnil(L);
         } else {
+            expose_attribute_list(node_attr(n));
             nodelib_pushattr(L, node_attr(n));
         }
     } else if (t == glyph_node) {
@@ -5450,6 +5853,7 @@ static int lua_nodelib_direct_getfield(lua_State * L)
             lua_pushnil(L);
         } else {
          /* nodelib_pushattr(L, node_attr(n)); */
+            expose_attribute_list(node_attr(n));
             lua_pushinteger(L, node_attr(n));
         }
     } else if (t == glyph_node) {
@@ -6512,6 +6916,7 @@ static int lua_nodelib_currentattr(lua_State * L)
       /* or null  (attr_list_cache can also be null)     */
        n = current_attribute_list();
        if (n) {
+          expose_attribute_list(n);
           lua_pushinteger(L, n);
           lua_nodelib_push(L);
        }
@@ -6533,10 +6938,12 @@ static int lua_nodelib_direct_currentattr(lua_State * L)
     /* current_attribute_list() return attr_list_cache */
     /* or null  (attr_list_cache can also be null)     */
     halfword n = current_attribute_list();
-    if (n)
+    if (n) {
+        expose_attribute_list(n);
         lua_pushinteger(L, n);
-    else
+    } else {
         lua_pushnil(L);
+    }
     return 1;
 }
 
@@ -7693,6 +8100,7 @@ static int lua_nodelib_direct_setfield(lua_State * L)
     } else if (lua_key_eq(s, attr)) {
         if (nodetype_has_attributes(type(n))) {
          /* nodelib_setattr(L, 3, n); */
+            expose_attribute_list(lua_tointeger(L, 3));
             reassign_attribute(n,lua_tointeger(L, 3));
         }
     } else if (t == glyph_node) {
@@ -8424,6 +8832,51 @@ static int lua_nodelib_direct_set_property(lua_State * L)
     return 0;
 }
 
+/*
+    Property slots are an opt-in alternative to the properties table: the value
+    is kept in a slot of node.properties.slots and the node knows its slot, see
+    texnodes.c for details. Only nodes that can have properties get a slot.
+*/
+
+/* node.direct.getpropertyslot */
+/* node.direct.setpropertyslot */
+
+static int lua_nodelib_direct_get_property_slot(lua_State * L)
+{   /* <direct> */
+    halfword n = lua_tointeger(L, 1);
+    if (n != null && varmem_property_slots != NULL && varmem_property_slots[n] != 0) {
+        lua_get_metatablelua(node_properties_slots);
+        lua_rawgeti(L, -1, varmem_property_slots[n]);
+    } else {
+        lua_pushnil(L);
+    }
+    return 1;
+}
+
+static int lua_nodelib_direct_set_property_slot(lua_State * L)
+{   /* <direct> <value> */
+    halfword n = lua_tointeger(L, 1);
+    if (n != null && nodetype_has_attributes(type(n))) {
+        lua_settop(L, 2);
+        lua_get_metatablelua(node_properties_slots);
+        if (lua_isnil(L, 2)) {
+            if (varmem_property_slots != NULL && varmem_property_slots[n] != 0) {
+                luaL_unref(L, -1, varmem_property_slots[n]);
+                varmem_property_slots[n] = 0;
+            }
+        } else {
+            allocate_property_slots();
+            lua_insert(L, -2);
+            if (varmem_property_slots[n] != 0) {
+                lua_rawseti(L, -2, varmem_property_slots[n]);
+            } else {
+                varmem_property_slots[n] = luaL_ref(L, -2);
+            }
+        }
+    }
+    return 0;
+}
+
 static int lua_nodelib_direct_properties_get_table(lua_State * L)
 {   /* <node|direct> */
     lua_get_metatablelua(node_properties);
@@ -8881,6 +9334,10 @@ static void lua_new_properties_table(lua_State * L)
     luaL_openlib(L, NULL, nodelib_p, 0);
     lua_setmetatable(L,-2);
     lua_settable(L,LUA_REGISTRYINDEX);
+
+    lua_pushstring(L,"node.properties.slots");
+    lua_newtable(L);
+    lua_settable(L,LUA_REGISTRYINDEX);
 }
 
 /* node.direct.* */
@@ -8908,6 +9365,10 @@ static const struct luaL_Reg direct_nodelib_f[] = {
     {"getpenalty", lua_nodelib_direct_getpenalty},
     {"getdir", lua_nodelib_direct_getdir},
     {"getoffsets", lua_nodelib_direct_getoffsets},
+    {"getlistfields", lua_nodelib_direct_getlistfields},
+    {"memorygeneration", lua_nodelib_direct_memorygeneration},
+    {"memorylayout", lua_nodelib_direct_memorylayout},
+    {"checknode", lua_nodelib_direct_checknode},
     {"getdisc", lua_nodelib_direct_getdisc},
     {"getwhd", lua_nodelib_direct_getwhd},
     {"getwidth", lua_nodelib_direct_getwidth},
@@ -8971,6 +9432,7 @@ static const struct luaL_Reg direct_nodelib_f[] = {
     {"setdir", lua_nodelib_direct_setdir},
     {"setdirection", lua_nodelib_direct_setdirection},
     {"setoffsets", lua_nodelib_direct_setoffsets},
+    {"setlistfields", lua_nodelib_direct_setlistfields},
     {"setdisc", lua_nodelib_direct_setdisc},
     {"setwhd", lua_nodelib_direct_setwhd},
     {"setwidth", lua_nodelib_direct_setwidth},
@@ -9017,6 +9479,8 @@ static const struct luaL_Reg direct_nodelib_f[] = {
     {"get_properties_table",lua_nodelib_direct_properties_get_table},
     {"getproperty", lua_nodelib_direct_get_property},
     {"setproperty", lua_nodelib_direct_set_property},
+    {"getpropertyslot", lua_nodelib_direct_get_property_slot},
+    {"setpropertyslot", lua_nodelib_direct_set_property_slot},
     {"effective_glue", lua_nodelib_direct_effective_glue},
     {"check_discretionary", lua_nodelib_direct_check_discretionary},
     {"check_discretionaries", lua_nodelib_direct_check_discretionaries},
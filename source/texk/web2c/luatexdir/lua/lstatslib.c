@@ -263,6 +263,12 @@ static lua_Number kpse_used_state(void)
     }
 }
 
+static int get_dyn_used(void)
+{
+    flush_pending_lists();
+    return dyn_used;
+}
+
 static lua_Number get_development_id(void)
 {
     return (lua_Number) luatex_svn_revision ;
@@ -282,6 +288,23 @@ static lua_Number get_dvi_ptr(void)
     return (lua_Number) 0;
 }
 
+static int push_phase_timers(lua_State * L)
+{
+    int t;
+    lua_createtable(L, 0, last_timer);
+    for (t = 0; t < last_timer; t++) {
+        lua_createtable(L, 0, 3);
+        lua_pushinteger(L, phase_timers[t].calls);
+        lua_setfield(L, -2, "calls");
+        lua_pushnumber(L, (lua_Number) phase_timers[t].cpu);
+        lua_setfield(L, -2, "cpu");
+        lua_pushnumber(L, (lua_Number) phase_timers[t].wall);
+        lua_setfield(L, -2, "wall");
+        lua_setfield(L, -2, phase_timer_names[t]);
+    }
+    return 1;
+}
+
 /* temp, for backward compat */
 
 static int init_pool_ptr = 0;
@@ -330,7 +353,7 @@ static struct statistic stats[] = {
      * mem stat
      */
     {"var_used", 'g', &var_used},
-    {"dyn_used", 'g', &dyn_used},
+    {"dyn_used", 'G', &get_dyn_used},
     /*
      * traditional tex stats
      */
@@ -385,6 +408,9 @@ static struct statistic stats[] = {
     {"lc_collate", 'S', (void *) &get_lc_collate},
     {"lc_numeric",'S', (void *) &get_lc_numeric},
 
+    {"timers_enabled", 'b', &phase_timers_enabled},
+    {"timers", 'T', (void *) &push_phase_timers},
+
     {NULL, 0, 0}
 };
 
@@ -406,6 +432,7 @@ static int do_getstat(lua_State * L, int i)
     intfunc g;
     numfunc n;
     int str;
+    lua_CFunction l;
     t = stats[i].type;
     switch (t) {
     case 'S':
@@ -447,6 +474,10 @@ static int do_getstat(lua_State * L, int i)
     case 'b':
         lua_pushboolean(L, *(int *) (stats[i].value));
         break;
+    case 'T':
+        l = stats[i].value;
+        l(L);
+        break;
     default:
         lua_pushnil(L);
     }
@@ -505,10 +536,50 @@ static int setexitcode(lua_State * L) {
     return 0;
 }
 
+static int enabletimers(lua_State * L)
+{
+    int enabled = lua_toboolean(L, 1);
+    if (enabled != phase_timers_enabled) {
+        /* we can be halfway a stage so we forget about pending starts */
+        int t;
+        for (t = 0; t < last_timer; t++)
+            phase_timers[t].level = 0;
+        phase_timers_enabled = enabled;
+    }
+    return 0;
+}
+
+static int resettimers(lua_State * L)
+{
+    (void) L;
+    reset_phase_timers();
+    return 0;
+}
+
+/*
+    status.telemetry("file.json",10) writes a record after each 10 pages,
+    status.telemetry() closes the log
+*/
+
+static int telemetry(lua_State * L)
+{
+    if (lua_type(L, 1) == LUA_TSTRING) {
+        const char *filename = lua_tostring(L, 1);
+        int interval = (int) luaL_optinteger(L, 2, 1);
+        lua_pushboolean(L, open_telemetry(filename, interval));
+        return 1;
+    }
+    close_telemetry();
+    return 0;
+}
+
 static const struct luaL_Reg statslib[] = {
     {"list", statslist},
     {"resetmessages", resetmessages},
     {"setexitcode", setexitcode},
+    {"enabletimers", enabletimers},
+    {"resettimers", resettimers},
+    {"telemetry", telemetry},
     {NULL, NULL}                /* sentinel */
 };
 
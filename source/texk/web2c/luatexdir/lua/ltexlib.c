@@ -29,6 +29,16 @@ extern int unif_rand(int );
 extern int norm_rand(void );
 extern void init_randoms(int );
 
+/*tex
+
+    A rope is a string, a node or a list of tokens. Consecutive tokens end up in
+    the same list so that a batch of tokens from \LUA\ gets injected as one
+    token list instead of token by token. Explicit braces and alignment tokens
+    get a rope of their own: a single token is pushed back with |back_input|,
+    which deals with |align_state| at the moment the token is read.
+
+*/
+
 typedef struct {
     char *text;
     unsigned int tsize;
@@ -36,6 +46,7 @@ typedef struct {
     boolean partial;
     int cattable;
     halfword tok;
+    halfword toktail;
     halfword nod;
 } rope;
 
@@ -55,6 +66,17 @@ static int spindle_size  = 0;
 static spindle *spindles = NULL;
 static int spindle_index = 0;
 
+static int luac_mergeable(halfword t)
+{
+    if (t >= cs_token_flag) {
+        int c = eq_type(t - cs_token_flag);
+        return c != tab_mark_cmd && c != car_ret_cmd;
+    } else {
+        int c = token_cmd(t);
+        return c != left_brace_cmd && c != right_brace_cmd && c != tab_mark_cmd;
+    }
+}
+
 static int luac_store(lua_State * L, int i, int partial, int cattable)
 {
     char *st = NULL;
@@ -76,8 +98,15 @@ static int luac_store(lua_State * L, int i, int partial, int cattable)
         } else if (lua_getmetatable(L, i)) {
             lua_get_metatablelua(luatex_token);
             if (lua_rawequal(L, -1, -2)) {
-                tok = (halfword) token_info((*((lua_token *)p)).token);
+                rope *rt = write_spindle.tail;
+                fast_get_avail(tok);
+                token_info(tok) = token_info((*((lua_token *)p)).token);
                 lua_pop(L, 2);
+                if (rt != NULL && rt->tok != null && luac_mergeable(token_info(rt->tok)) && luac_mergeable(token_info(tok))) {
+                    token_link(rt->toktail) = tok;
+                    rt->toktail = tok;
+                    return 1;
+                }
             } else {
                 lua_get_metatablelua(luatex_node);
                 if (lua_rawequal(L, -1, -3)) {
@@ -100,6 +129,7 @@ static int luac_store(lua_State * L, int i, int partial, int cattable)
     rn->text = st;
     rn->tsize = (unsigned) tsize;
     rn->tok = tok;
+    rn->toktail = tok;
     rn->nod = nod;
     rn->next = NULL;
     rn->partial = partial;
@@ -284,8 +314,10 @@ int luacstring_input(halfword *n)
         }
         free(t->text);
         t->text = NULL;
-    } else if (t->tok > 0) {
+    } else if (t->tok != null) {
+        /* the list is now owned by the input stack */
         *n = t->tok;
+        t->tok = null;
         ret = 2;
     } else if (t->nod > 0) {
         *n = t->nod;
@@ -326,6 +358,8 @@ void luacstring_close(int n)
     while (next != NULL) {
         if (next->text != NULL)
             free(next->text);
+        if (next->tok != null)
+            flush_list(next->tok);
         t = next;
         next = next->next;
         if (t==read_spindle.tail) {
@@ -2927,10 +2961,13 @@ static halfword nodelib_topenalties(lua_State * L, int i)
     return p;
 }
 
-static int tex_run_linebreak(lua_State * L)
-{
+/*
+    Break the list that starts at |head| with the parameters in the table at
+    index |t|, and push the resulting list and its info table.
+*/
 
-    halfword *j;
+static void tex_linebreak_list(lua_State * L, halfword head, int t)
+{
     halfword p;
     halfword final_par_glue;
     int paragraph_dir = 0;
@@ -2947,11 +2984,10 @@ static int tex_run_linebreak(lua_State * L)
     push_nest();
     save_vlink_tmp_head = vlink(temp_head);
 
-    j = check_isnode(L, 1);     /* the value */
-    vlink(temp_head) = *j;
-    p = *j;
-    if ((!is_char_node(vlink(*j))) && ((type(vlink(*j)) == local_par_node))) {
-        paragraph_dir = local_par_dir(vlink(*j));
+    vlink(temp_head) = head;
+    p = head;
+    if ((!is_char_node(vlink(head))) && ((type(vlink(head)) == local_par_node))) {
+        paragraph_dir = local_par_dir(vlink(head));
     }
 
     while (vlink(p) != null)
@@ -2960,10 +2996,8 @@ static int tex_run_linebreak(lua_State * L)
 
     /* initialize local parameters */
 
-    if (lua_gettop(L) != 2 || lua_type(L, 2) != LUA_TTABLE) {
-        lua_checkstack(L, 3);
-        lua_newtable(L);
-    }
+    lua_checkstack(L, 4);
+    lua_pushvalue(L, t);
     lua_key_rawgeti(pardir);
     if (lua_type(L, -1) == LUA_TSTRING) {
         paragraph_dir = nodelib_getdir(L, -1);
@@ -2999,6 +3033,7 @@ static int tex_run_linebreak(lua_State * L)
     get_dimen_par(hsize, hsize_par);
     get_glue_par (leftskip, left_skip_par);
     get_glue_par (rightskip, right_skip_par);
+    lua_pop(L, 1);
     ext_do_line_break(paragraph_dir,
                       pretolerance,
                       tracingparagraphs,
@@ -3049,6 +3084,41 @@ static int tex_run_linebreak(lua_State * L)
     pop_nest();
     if (parshape != equiv(par_shape_loc))
         flush_node(parshape);
+}
+
+/*
+    The first argument is either a list or an array of lists. The lists in
+    an array are independent paragraphs that share the parameters, and we
+    return an array of results and an array of info tables. The breaker is
+    reentrant but node memory and callbacks are not thread safe, so the
+    paragraphs are broken one after the other.
+*/
+
+static int tex_run_linebreak(lua_State * L)
+{
+    if (lua_type(L, 2) != LUA_TTABLE) {
+        lua_settop(L, 1);
+        lua_newtable(L);
+    } else {
+        lua_settop(L, 2);
+    }
+    if (lua_type(L, 1) == LUA_TTABLE) {
+        int i;
+        int n = (int) lua_rawlen(L, 1);
+        lua_createtable(L, n, 0);
+        lua_createtable(L, n, 0);
+        for (i = 1; i <= n; i++) {
+            halfword head;
+            lua_rawgeti(L, 1, i);
+            head = *check_isnode(L, -1);
+            lua_pop(L, 1);
+            tex_linebreak_list(L, head, 2);
+            lua_rawseti(L, 4, i);
+            lua_rawseti(L, 3, i);
+        }
+    } else {
+        tex_linebreak_list(L, *check_isnode(L, 1), 2);
+    }
     return 2;
 }
 
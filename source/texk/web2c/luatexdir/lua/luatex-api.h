@@ -949,6 +949,7 @@ make_lua_key(noad);\
 make_lua_key(noadpenalty);\
 make_lua_key(node);\
 make_lua_key(node_properties);\
+make_lua_key(node_properties_slots);\
 make_lua_key(node_properties_indirect);\
 make_lua_key(nohrule);\
 make_lua_key(nomath);\
@@ -1970,6 +1971,7 @@ init_lua_key_alias(mRTT,"-RTT");\
 init_lua_key_alias(mTLT,"-TLT");\
 init_lua_key_alias(mTRT,"-TRT");\
 init_lua_key_alias(node_properties,"node.properties");\
+init_lua_key_alias(node_properties_slots,"node.properties.slots");\
 init_lua_key_alias(node_properties_indirect,"node.properties.indirect");\
 init_lua_key_alias(pLTL,"+LTL");\
 init_lua_key_alias(pRTT,"+RTT");\
@@ -2424,6 +2426,7 @@ use_lua_key(noad);
 use_lua_key(noadpenalty);
 use_lua_key(node);
 use_lua_key(node_properties);
+use_lua_key(node_properties_slots);
 use_lua_key(node_properties_indirect);
 use_lua_key(nohrule);
 use_lua_key(nomath);
@@ -14,6 +14,17 @@ describe("harfbuzz.Buffer", function()
     assert.are_equal(glyphs[1].codepoint, 0x06CC)
   end)
 
+  it("can get glyph data as arrays", function()
+    local b = harfbuzz.Buffer.new()
+    b:add(0x06CC, 42)
+    b:add(0x06C1, 43)
+    local t = { codepoint = { }, cluster = { }, x_offset = { 1, 2, 3 } }
+    assert.are_equal(2, b:get_glyph_fields(t))
+    assert.are_same({ 0x06CC, 0x06C1 }, t.codepoint)
+    assert.are_same({ 42, 43 }, t.cluster)
+    assert.are_equal(2, #t.x_offset)
+  end)
+
   it("can add a UTF8 string", function()
     local b = harfbuzz.Buffer.new()
     local s = "Some String"
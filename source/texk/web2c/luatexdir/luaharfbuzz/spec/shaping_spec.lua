@@ -145,6 +145,24 @@ describe("harfbuzz module shaping functions", function()
       compare_glyphs_against_fixture(glyphs, "amiri-regular_123_numr.json")
     end)
 
+    it("can cache shaped runs",function()
+      local shape = function()
+        local b = harfbuzz.Buffer.new()
+        b:add_utf8(urdu_text)
+        harfbuzz.shape(font, b, { features = "+kern" })
+        return b:get_glyphs()
+      end
+      local uncached = shape()
+      harfbuzz.shape_cache(16)
+      shape()
+      local cached = shape()
+      local stats = harfbuzz.shape_cache_stats()
+      harfbuzz.shape_cache(0)
+      assert.are_equal(1, stats.misses)
+      assert.are_equal(1, stats.hits)
+      assert.are_same(uncached, cached)
+    end)
+
     it("can set specefic shaper",function()
       options.shapers = { "fallback"}
       harfbuzz.shape(font, buf, options)
@@ -149,6 +149,16 @@ static int buffer_add(lua_State *L) {
   return 0;
 }
 
+static hb_user_data_key_t context_key;
+
+void luahb_buffer_set_context(hb_buffer_t *buffer, int context) {
+  hb_buffer_set_user_data(buffer, &context_key, context ? (void *) &context_key : NULL, NULL, 1);
+}
+
+int luahb_buffer_has_context(hb_buffer_t *buffer) {
+  return hb_buffer_get_user_data(buffer, &context_key) != NULL;
+}
+
 static int buffer_add_codepoints(lua_State *L) {
   Buffer *b = (Buffer *)luaL_checkudata(L, 1, "harfbuzz.Buffer");
   unsigned int item_offset;
@@ -171,6 +181,8 @@ static int buffer_add_codepoints(lua_State *L) {
   }
 
   hb_buffer_add_codepoints(*b, text, n, item_offset, item_length);
+  if (item_offset > 0 || (item_length >= 0 && item_offset + item_length < (unsigned int) n))
+    luahb_buffer_set_context(*b, 1);
 
   free(text);
 
@@ -181,6 +193,7 @@ static int buffer_clear_contents(lua_State *L) {
   Buffer *b = (Buffer *)luaL_checkudata(L, 1, "harfbuzz.Buffer");
 
   hb_buffer_clear_contents(*b);
+  luahb_buffer_set_context(*b, 0);
   return 0;
 }
 
@@ -188,6 +201,7 @@ static int buffer_reset(lua_State *L) {
   Buffer *b = (Buffer *)luaL_checkudata(L, 1, "harfbuzz.Buffer");
 
   hb_buffer_reset(*b);
+  luahb_buffer_set_context(*b, 0);
   return 0;
 }
 
@@ -202,6 +216,8 @@ static int buffer_add_utf8(lua_State *L) {
   item_length = luaL_optinteger(L, 4, -1);
 
   hb_buffer_add_utf8(*b, text, -1, item_offset, item_length);
+  if (item_offset > 0 || (item_length >= 0 && item_offset + item_length < strlen(text)))
+    luahb_buffer_set_context(*b, 1);
 
   return 0;
 }
@@ -260,6 +276,84 @@ static int buffer_get_glyphs(lua_State *L) {
   return 1;
 }
 
+// Fill the arrays present in the table at index 2 with glyph data, without a
+// table per glyph. The arrays can be reused between calls. Positions are
+// multiplied by the optional scale and rounded, so that they can be put in
+// nodes directly.
+static const char *glyph_field_names[] = {
+  "codepoint", "cluster", "x_advance", "y_advance", "x_offset", "y_offset", "flags", NULL
+};
+
+static void set_glyph_field(lua_State *L, int t, unsigned int i, hb_position_t v, double scale) {
+  if (scale != 0) {
+    double d = v * scale;
+    lua_pushinteger(L, (lua_Integer) (d < 0 ? d - 0.5 : d + 0.5));
+  } else {
+    lua_pushnumber(L, v);
+  }
+  lua_rawseti(L, t, i + 1);
+}
+
+static int buffer_get_glyph_fields(lua_State *L) {
+  Buffer *buf = (Buffer *)luaL_checkudata(L, 1, "harfbuzz.Buffer");
+  double scale = luaL_optnumber(L, 3, 0);
+  unsigned int len = hb_buffer_get_length(*buf);
+  hb_glyph_info_t *info = hb_buffer_get_glyph_infos(*buf, NULL);
+  hb_glyph_position_t *pos = hb_buffer_get_glyph_positions(*buf, NULL);
+  unsigned int i, n;
+  int f, t;
+
+  luaL_checktype(L, 2, LUA_TTABLE);
+  lua_settop(L, 2);
+
+  for (f = 0; glyph_field_names[f]; f++) {
+    lua_getfield(L, 2, glyph_field_names[f]);
+    if (lua_type(L, -1) != LUA_TTABLE) {
+      lua_pop(L, 1);
+      continue;
+    }
+    t = lua_gettop(L);
+    for (i = 0; i < len; i++) {
+      switch (f) {
+        case 0:
+          lua_pushinteger(L, info[i].codepoint);
+          lua_rawseti(L, t, i + 1);
+          break;
+        case 1:
+          lua_pushinteger(L, info[i].cluster);
+          lua_rawseti(L, t, i + 1);
+          break;
+        case 2:
+          set_glyph_field(L, t, i, pos[i].x_advance, scale);
+          break;
+        case 3:
+          set_glyph_field(L, t, i, pos[i].y_advance, scale);
+          break;
+        case 4:
+          set_glyph_field(L, t, i, pos[i].x_offset, scale);
+          break;
+        case 5:
+          set_glyph_field(L, t, i, pos[i].y_offset, scale);
+          break;
+        case 6:
+          lua_pushinteger(L, hb_glyph_info_get_glyph_flags(&(info[i])));
+          lua_rawseti(L, t, i + 1);
+          break;
+      }
+    }
+    // Drop what is left from an earlier and longer run.
+    n = lua_rawlen(L, t);
+    for (i = len + 1; i <= n; i++) {
+      lua_pushnil(L);
+      lua_rawseti(L, t, i);
+    }
+    lua_pop(L, 1);
+  }
+
+  lua_pushinteger(L, len);
+  return 1;
+}
+
 static int buffer_reverse(lua_State *L) {
   Buffer *b = (Buffer *)luaL_checkudata(L, 1, "harfbuzz.Buffer");
 
@@ -318,6 +412,7 @@ static const struct luaL_Reg buffer_methods[] = {
   { "set_replacement_codepoint", buffer_set_replacement_codepoint },
   { "get_replacement_codepoint", buffer_get_replacement_codepoint },
   { "get_glyphs", buffer_get_glyphs },
+  { "get_glyph_fields", buffer_get_glyph_fields },
   { "guess_segment_properties", buffer_guess_segment_properties },
   { "reset", buffer_reset },
   { "reverse", buffer_reverse },
@@ -1,4 +1,5 @@
 #include "luaharfbuzz.h"
+#include <sys/stat.h>
 
 #ifdef LuajitTeX
 
@@ -19,17 +20,98 @@ static void lua_seti (lua_State *L, int index, lua_Integer i) {
  * data from HarfBuzz. */
 #define STATIC_ARRAY_SIZE 128
 
+/* Faces loaded from a file are shared: asking again for the same file and
+ * index gives the face that is already loaded, as long as it is in use and
+ * the file has not changed. All fonts made from it then use one mapped blob,
+ * one set of parsed tables and one cache of shape plans. The registry holds
+ * no reference, an entry is dropped when its face is destroyed. */
+typedef struct face_registry_entry {
+  struct face_registry_entry *next;
+  char *file_name;
+  unsigned int face_index;
+  time_t mtime;
+  off_t size;
+  hb_face_t *face;
+} face_registry_entry;
+
+static face_registry_entry *face_registry = NULL;
+static hb_user_data_key_t face_registry_key;
+
+static void face_registry_unlink(face_registry_entry *e) {
+  face_registry_entry **p = &face_registry;
+  while (*p && *p != e)
+    p = &(*p)->next;
+  if (*p)
+    *p = e->next;
+}
+
+static void face_registry_remove(void *data) {
+  face_registry_entry *e = (face_registry_entry *) data;
+  face_registry_unlink(e);
+  free(e->file_name);
+  free(e);
+}
+
+static hb_face_t *face_create_from_file(const char *file_name, unsigned int face_index) {
+  hb_blob_t *blob = hb_blob_create_from_file(file_name);
+  hb_face_t *face = hb_face_create(blob, face_index);
+  int empty = blob == hb_blob_get_empty() || face == hb_face_get_empty();
+
+  /* The face keeps its own reference to the blob. */
+  hb_blob_destroy(blob);
+  if (empty) {
+    hb_face_destroy(face);
+    return NULL;
+  }
+  return face;
+}
+
+static hb_face_t *face_registry_get(const char *file_name, unsigned int face_index) {
+  struct stat st;
+  face_registry_entry *e;
+  hb_face_t *face;
+
+  if (stat(file_name, &st) != 0)
+    return face_create_from_file(file_name, face_index);
+
+  for (e = face_registry; e; e = e->next) {
+    if (e->face_index == face_index && strcmp(e->file_name, file_name) == 0) {
+      if (e->mtime == st.st_mtime && e->size == st.st_size)
+        return hb_face_reference(e->face);
+      /* The file has changed, the old face stays valid for its users. */
+      face_registry_unlink(e);
+      break;
+    }
+  }
+
+  face = face_create_from_file(file_name, face_index);
+  if (face) {
+    e = (face_registry_entry *) malloc(sizeof(face_registry_entry));
+    e->file_name = strdup(file_name);
+    e->face_index = face_index;
+    e->mtime = st.st_mtime;
+    e->size = st.st_size;
+    e->face = face;
+    if (hb_face_set_user_data(face, &face_registry_key, e, face_registry_remove, 1)) {
+      e->next = face_registry;
+      face_registry = e;
+    } else {
+      free(e->file_name);
+      free(e);
+    }
+  }
+  return face;
+}
+
 static int face_new(lua_State *L) {
   Face *f;
-  hb_blob_t *blob;
   hb_face_t *face;
   const char *file_name = luaL_checkstring(L, 1);
   unsigned int face_index = (unsigned int) luaL_optinteger(L, 2, 0);
 
-  blob = hb_blob_create_from_file(file_name);
-  face = hb_face_create(blob, face_index);
+  face = face_registry_get(file_name, face_index);
 
-  if (blob == hb_blob_get_empty() || face == hb_face_get_empty()) {
+  if (!face) {
     lua_pushnil(L);
   } else {
     f = (Face *)lua_newuserdata(L, sizeof(*f));
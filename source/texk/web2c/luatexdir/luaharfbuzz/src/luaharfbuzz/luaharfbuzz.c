@@ -13,6 +13,253 @@ static int lua_geti (lua_State *L, int index, lua_Integer i) {
 }
 #endif
 
+// Shaping cache. Running text repeats the same words over and over, so when
+// enabled we keep the shaped glyphs of short runs and copy them into the
+// buffer when the same input is shaped again with the same font, features
+// and buffer properties. The key includes the font serial, so changing the
+// scale or variations of a font invalidates its entries. Runs with context
+// or an explicit shaper list are always shaped.
+
+#define SHAPE_CACHE_MAX_LENGTH 64
+
+typedef struct shape_cache_entry {
+  struct shape_cache_entry *next;
+  unsigned int hash;
+  hb_font_t *font;
+  unsigned int serial;
+  hb_segment_properties_t props;
+  hb_buffer_flags_t flags;
+  hb_buffer_cluster_level_t cluster_level;
+  hb_codepoint_t invisible_glyph;
+  hb_codepoint_t not_found_glyph;
+  unsigned int num_features;
+  hb_feature_t *features;
+  unsigned int length;
+  hb_codepoint_t *input;
+  unsigned int num_glyphs;
+  hb_glyph_info_t *infos;
+  hb_glyph_position_t *positions;
+} shape_cache_entry;
+
+static struct {
+  unsigned int size;
+  unsigned int entries;
+  unsigned int buckets;
+  unsigned int oldest;
+  shape_cache_entry **hash;
+  shape_cache_entry **fifo;
+  lua_Integer hits;
+  lua_Integer misses;
+  lua_Integer evictions;
+} shape_cache = { 0, 0, 0, 0, NULL, NULL, 0, 0, 0 };
+
+static unsigned int shape_cache_mix (unsigned int h, unsigned int v) {
+  return (h ^ v) * 16777619u;
+}
+
+static void shape_cache_free_entry (shape_cache_entry *e) {
+  hb_font_destroy(e->font);
+  free(e->features);
+  free(e->input);
+  free(e->infos);
+  free(e->positions);
+  free(e);
+}
+
+static void shape_cache_flush (void) {
+  unsigned int i;
+  for (i = 0; i < shape_cache.size; i++) {
+    if (shape_cache.fifo[i])
+      shape_cache_free_entry(shape_cache.fifo[i]);
+  }
+  free(shape_cache.fifo);
+  free(shape_cache.hash);
+  shape_cache.size = 0;
+  shape_cache.entries = 0;
+  shape_cache.buckets = 0;
+  shape_cache.oldest = 0;
+  shape_cache.fifo = NULL;
+  shape_cache.hash = NULL;
+  shape_cache.hits = 0;
+  shape_cache.misses = 0;
+  shape_cache.evictions = 0;
+}
+
+// Fills in the key part of an entry from the buffer, the arrays are not
+// copied yet so that a lookup doesn't allocate anything.
+static void shape_cache_make_key (shape_cache_entry *key, hb_font_t *font, hb_buffer_t *buf, const hb_feature_t *features, unsigned int num_features, hb_glyph_info_t *input) {
+  unsigned int i, h = 2166136261u;
+  key->font = font;
+  key->serial = hb_font_get_serial(font);
+  hb_buffer_get_segment_properties(buf, &key->props);
+  key->flags = hb_buffer_get_flags(buf);
+  key->cluster_level = hb_buffer_get_cluster_level(buf);
+  key->invisible_glyph = hb_buffer_get_invisible_glyph(buf);
+  key->not_found_glyph = hb_buffer_get_not_found_glyph(buf);
+  key->num_features = num_features;
+  key->features = (hb_feature_t *) features;
+  key->length = hb_buffer_get_length(buf);
+  h = shape_cache_mix(h, (unsigned int) (size_t) font);
+  h = shape_cache_mix(h, key->serial);
+  h = shape_cache_mix(h, hb_segment_properties_hash(&key->props));
+  h = shape_cache_mix(h, (unsigned int) key->flags);
+  h = shape_cache_mix(h, (unsigned int) key->cluster_level);
+  for (i = 0; i < num_features; i++) {
+    h = shape_cache_mix(h, features[i].tag);
+    h = shape_cache_mix(h, features[i].value);
+  }
+  for (i = 0; i < key->length; i++) {
+    h = shape_cache_mix(h, input[i].codepoint);
+    h = shape_cache_mix(h, input[i].cluster);
+  }
+  key->hash = h;
+}
+
+static int shape_cache_matches (const shape_cache_entry *e, const shape_cache_entry *key, const hb_glyph_info_t *input) {
+  unsigned int i;
+  if (e->hash != key->hash || e->font != key->font || e->serial != key->serial
+      || e->length != key->length || e->num_features != key->num_features
+      || e->flags != key->flags || e->cluster_level != key->cluster_level
+      || e->invisible_glyph != key->invisible_glyph || e->not_found_glyph != key->not_found_glyph
+      || !hb_segment_properties_equal(&e->props, &key->props))
+    return 0;
+  if (key->num_features && memcmp(e->features, key->features, key->num_features * sizeof(hb_feature_t)))
+    return 0;
+  for (i = 0; i < key->length; i++) {
+    if (e->input[2*i] != input[i].codepoint || e->input[2*i+1] != input[i].cluster)
+      return 0;
+  }
+  return 1;
+}
+
+static shape_cache_entry *shape_cache_lookup (const shape_cache_entry *key, const hb_glyph_info_t *input) {
+  shape_cache_entry *e = shape_cache.hash[key->hash & (shape_cache.buckets - 1)];
+  while (e && !shape_cache_matches(e, key, input))
+    e = e->next;
+  return e;
+}
+
+static void shape_cache_evict (shape_cache_entry *e) {
+  shape_cache_entry **p = &shape_cache.hash[e->hash & (shape_cache.buckets - 1)];
+  while (*p != e)
+    p = &(*p)->next;
+  *p = e->next;
+  shape_cache_free_entry(e);
+  shape_cache.entries--;
+  shape_cache.evictions++;
+}
+
+// The key is saved before shaping because shaping replaces the input.
+static shape_cache_entry *shape_cache_new_entry (const shape_cache_entry *key, const hb_glyph_info_t *input) {
+  unsigned int i;
+  shape_cache_entry *e = (shape_cache_entry *) malloc(sizeof(shape_cache_entry));
+  *e = *key;
+  e->next = NULL;
+  e->font = hb_font_reference(key->font);
+  e->features = NULL;
+  if (key->num_features) {
+    e->features = (hb_feature_t *) malloc(key->num_features * sizeof(hb_feature_t));
+    memcpy(e->features, key->features, key->num_features * sizeof(hb_feature_t));
+  }
+  e->input = (hb_codepoint_t *) malloc(2 * key->length * sizeof(hb_codepoint_t));
+  for (i = 0; i < key->length; i++) {
+    e->input[2*i] = input[i].codepoint;
+    e->input[2*i+1] = input[i].cluster;
+  }
+  e->num_glyphs = 0;
+  e->infos = NULL;
+  e->positions = NULL;
+  return e;
+}
+
+static void shape_cache_store (shape_cache_entry *e, hb_buffer_t *buf) {
+  unsigned int n = hb_buffer_get_length(buf);
+  shape_cache_entry **slot = &shape_cache.fifo[shape_cache.oldest];
+  unsigned int bucket = e->hash & (shape_cache.buckets - 1);
+  e->num_glyphs = n;
+  e->infos = (hb_glyph_info_t *) malloc((n ? n : 1) * sizeof(hb_glyph_info_t));
+  e->positions = (hb_glyph_position_t *) malloc((n ? n : 1) * sizeof(hb_glyph_position_t));
+  memcpy(e->infos, hb_buffer_get_glyph_infos(buf, NULL), n * sizeof(hb_glyph_info_t));
+  memcpy(e->positions, hb_buffer_get_glyph_positions(buf, NULL), n * sizeof(hb_glyph_position_t));
+  if (*slot)
+    shape_cache_evict(*slot);
+  *slot = e;
+  e->next = shape_cache.hash[bucket];
+  shape_cache.hash[bucket] = e;
+  shape_cache.entries++;
+  shape_cache.oldest = (shape_cache.oldest + 1) % shape_cache.size;
+}
+
+// Puts the cached glyphs in the buffer, which is then in the same state as
+// after a call to hb_shape_full.
+static int shape_cache_apply (const shape_cache_entry *e, hb_buffer_t *buf) {
+  if (!hb_buffer_set_length(buf, e->num_glyphs))
+    return 0;
+  hb_buffer_set_content_type(buf, HB_BUFFER_CONTENT_TYPE_GLYPHS);
+  memcpy(hb_buffer_get_glyph_infos(buf, NULL), e->infos, e->num_glyphs * sizeof(hb_glyph_info_t));
+  memcpy(hb_buffer_get_glyph_positions(buf, NULL), e->positions, e->num_glyphs * sizeof(hb_glyph_position_t));
+  return 1;
+}
+
+static hb_bool_t shape_cached (hb_font_t *font, hb_buffer_t *buf, const hb_feature_t *features, unsigned int num_features) {
+  unsigned int length = hb_buffer_get_length(buf);
+  hb_glyph_info_t *input;
+  shape_cache_entry key;
+  shape_cache_entry *e;
+  hb_bool_t ok;
+
+  if (length == 0 || length > SHAPE_CACHE_MAX_LENGTH || luahb_buffer_has_context(buf)
+      || hb_buffer_get_content_type(buf) != HB_BUFFER_CONTENT_TYPE_UNICODE)
+    return hb_shape_full(font, buf, features, num_features, NULL);
+
+  input = hb_buffer_get_glyph_infos(buf, NULL);
+  shape_cache_make_key(&key, font, buf, features, num_features, input);
+  e = shape_cache_lookup(&key, input);
+  if (e && shape_cache_apply(e, buf)) {
+    shape_cache.hits++;
+    return 1;
+  }
+
+  shape_cache.misses++;
+  e = shape_cache_new_entry(&key, input);
+  ok = hb_shape_full(font, buf, features, num_features, NULL);
+  if (ok)
+    shape_cache_store(e, buf);
+  else
+    shape_cache_free_entry(e);
+  return ok;
+}
+
+static int set_shape_cache (lua_State *L) {
+  lua_Integer size = luaL_checkinteger(L, 1);
+  shape_cache_flush();
+  if (size > 0) {
+    unsigned int buckets = 16;
+    while (buckets < (unsigned int) size)
+      buckets <<= 1;
+    shape_cache.size = (unsigned int) size;
+    shape_cache.buckets = buckets;
+    shape_cache.fifo = (shape_cache_entry **) calloc(shape_cache.size, sizeof(shape_cache_entry *));
+    shape_cache.hash = (shape_cache_entry **) calloc(buckets, sizeof(shape_cache_entry *));
+  }
+  return 0;
+}
+
+static int get_shape_cache_stats (lua_State *L) {
+  lua_createtable(L, 0, 5);
+  lua_pushinteger(L, shape_cache.size);
+  lua_setfield(L, -2, "size");
+  lua_pushinteger(L, shape_cache.entries);
+  lua_setfield(L, -2, "entries");
+  lua_pushinteger(L, shape_cache.hits);
+  lua_setfield(L, -2, "hits");
+  lua_pushinteger(L, shape_cache.misses);
+  lua_setfield(L, -2, "misses");
+  lua_pushinteger(L, shape_cache.evictions);
+  lua_setfield(L, -2, "evictions");
+  return 1;
+}
+
 static int shape_full (lua_State *L) {
   Font *font = (Font *)luaL_checkudata(L, 1, "harfbuzz.Font");
   Buffer *buf = (Buffer *)luaL_checkudata(L, 2, "harfbuzz.Buffer");
@@ -42,7 +289,10 @@ static int shape_full (lua_State *L) {
   }
 
   // Shape text
-  lua_pushboolean(L, hb_shape_full(*font, *buf, features, num_features, shapers));
+  if (shape_cache.size && !shapers)
+    lua_pushboolean(L, shape_cached(*font, *buf, features, num_features));
+  else
+    lua_pushboolean(L, hb_shape_full(*font, *buf, features, num_features, shapers));
 
   free(features);
   free(shapers);
@@ -68,6 +318,8 @@ static int list_shapers (lua_State *L) {
 
 static const struct luaL_Reg lib_table [] = {
   {"shape_full", shape_full},
+  {"shape_cache", set_shape_cache},
+  {"shape_cache_stats", get_shape_cache_stats},
   {"version", version},
   {"shapers", list_shapers},
   {NULL, NULL}
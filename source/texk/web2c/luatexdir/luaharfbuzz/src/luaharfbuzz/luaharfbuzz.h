@@ -40,5 +40,10 @@ int register_variation(lua_State *L);
 int register_ot(lua_State *L);
 int register_unicode(lua_State *L);
 
+// Buffers that got text with surrounding context are never served from the
+// shaping cache, the buffer functions keep track of that.
+void luahb_buffer_set_context(hb_buffer_t *buffer, int context);
+int luahb_buffer_has_context(hb_buffer_t *buffer);
+
 // Missed declaration
 int luaopen_luaharfbuzz (lua_State *L);
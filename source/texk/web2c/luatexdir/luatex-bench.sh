@@ -0,0 +1,33 @@
+#! /bin/sh
+
+# Copyright (C) 2026 The LuaTeX team
+# You may freely use, modify and/or distribute this file.
+
+# Not a test: run the benchmark scenarios in luatexdir/tests/bench-*.tex with
+# the given engine (default ./luatex). Every scenario appends one line of JSON
+# with pages, time, pages per second, peak RSS, node memory and output size to
+# $LUATEX_BENCH_OUTPUT (default luatex-bench.json). Set LUATEX_BENCH_SCALE to
+# change the amount of work and LUATEX_BENCH_TIMERS to include the stage timers.
+
+engine=${1-./luatex}
+scenarios=${LUATEX_BENCH_SCENARIOS-"text math tables images fonts callbacks"}
+
+TEXMFCNF=$srcdir/../kpathsea
+TEXINPUTS=$srcdir/luatexdir/tests:$srcdir/tests
+TEXFORMATS=.
+LUATEX_BENCH_OUTPUT=${LUATEX_BENCH_OUTPUT-luatex-bench.json}
+
+export TEXMFCNF TEXINPUTS TEXFORMATS LUATEX_BENCH_OUTPUT
+
+rm -f "$LUATEX_BENCH_OUTPUT"
+
+for scenario in $scenarios; do
+  $engine -ini -interaction=batchmode bench-$scenario >/dev/null || {
+    echo "$0: scenario $scenario failed, see bench-$scenario.log" >&2
+    exit 1
+  }
+done
+
+cat "$LUATEX_BENCH_OUTPUT"
+
+exit 0
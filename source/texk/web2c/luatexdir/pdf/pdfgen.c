@@ -302,6 +302,7 @@ static void write_zip(PDF pdf)
     strbuf_s *buf = pdf->buf;
     z_stream *s = pdf->c_stream;
     boolean finish = pdf->zip_write_state == ZIP_FINISH;
+    phase_timer_start(compress_timer);
     if (pdf->stream_length == 0) {
         if (s == NULL) {
             s = pdf->c_stream = xtalloc(1, z_stream);
@@ -342,6 +343,7 @@ static void write_zip(PDF pdf)
             formatted_error("pdf backend","zlib deflate() failed (error code %d)", err);
     }
     pdf->stream_length = (off_t) s->total_out;
+    phase_timer_stop(compress_timer);
 }
 
 void zip_free(PDF pdf)
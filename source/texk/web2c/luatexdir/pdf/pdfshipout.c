@@ -43,6 +43,7 @@ void ship_out(PDF pdf, halfword p, shipping_mode_e shipping_mode)
     scaledpos cur = { 0, 0 };
     refpoint.pos.h = 0;
     refpoint.pos.v = 0;
+    phase_timer_start(shipout_timer);
     ensure_output_state(pdf, ST_HEADER_WRITTEN);
     /*tex This is only for complaining if \.{\\outputmode} has changed: */
     fix_o_mode();
@@ -267,6 +268,7 @@ void ship_out(PDF pdf, halfword p, shipping_mode_e shipping_mode)
     dead_cycles = 0;
     /*tex Flush the box from memory, showing statistics if requested. */
     if ((tracing_stats_par > 1) && (pre_callback_id == 0)) {
+        flush_pending_lists();
         tprint_nl("Memory usage before: ");
         print_int(var_used);
         print_char('&');
@@ -275,6 +277,7 @@ void ship_out(PDF pdf, halfword p, shipping_mode_e shipping_mode)
     }
     flush_node_list(p);
     if ((tracing_stats_par > 1) && (post_callback_id == 0)) {
+        flush_pending_lists();
         tprint(" after: ");
         print_int(var_used);
         print_char('&');
@@ -287,4 +290,7 @@ void ship_out(PDF pdf, halfword p, shipping_mode_e shipping_mode)
     if (synctex_par)
         synctexteehs();
     global_shipping_mode = NOT_SHIPPING;
+    phase_timer_stop(shipout_timer);
+    if (shipping_mode == SHIPPING_PAGE)
+        telemetry_page_shipped();
 }
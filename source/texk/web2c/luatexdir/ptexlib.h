@@ -160,6 +160,7 @@ size_t          T##_limit
 
 #  include "utils/avlstuff.h"
 #  include "utils/managed-sa.h"
+#  include "utils/timers.h"
 
 #  include "image/writeimg.h"
 
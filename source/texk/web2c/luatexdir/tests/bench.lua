@@ -0,0 +1,320 @@
+-- Copyright (C) 2026 The LuaTeX team
+-- You may freely use, modify and/or distribute this file.
+--
+-- Helpers for the luatex-bench scenarios. All input is generated with a fixed
+-- seed and the fonts are rule based virtual fonts, so that the runs don't
+-- depend on a TeX tree and every build processes the same document.
+
+local bench = { }
+
+bench.scale = tonumber(os.getenv("LUATEX_BENCH_SCALE") or "") or 1
+bench.output = os.getenv("LUATEX_BENCH_OUTPUT") or "luatex-bench.json"
+
+local floor, concat, format = math.floor, table.concat, string.format
+
+-- Park-Miller, the products stay below 2^53 so luajit gives the same results
+
+local seed = 1
+
+function bench.random(n)
+    seed = (seed * 16807) % 2147483647
+    return seed % n
+end
+
+-- fonts
+
+local function parameters(size,extra)
+    local p = {
+        slant         = 0,
+        space         = floor(size/3),
+        space_stretch = floor(size/6),
+        space_shrink  = floor(size/9),
+        x_height      = floor(size*0.43),
+        quad          = size,
+        extra_space   = floor(size/9),
+    }
+    if extra then
+        for i=1,#extra do
+            p[7+i] = floor(size*extra[i])
+        end
+    end
+    return p
+end
+
+-- the 15 traditional math symbol and 6 extension font parameters (cmsy/cmex)
+
+local symbolparameters    = { .677, .394, .444, .686, .345, .413, .363, .289, .150, .247, .386, .050, 2.39, 1.01, .250 }
+local extensionparameters = { .040, .111, .167, .200, .600, .100 }
+
+function bench.definefont(name,size,variant,extra)
+    local characters = { }
+    local descenders = { [103] = true, [106] = true, [112] = true, [113] = true, [121] = true }
+    for c=0,255 do
+        local w = floor(size * (30 + (c * 7 + variant * 13) % 40) / 100)
+        local h = floor(size * (0.60 + ((c + variant) % 3) / 20))
+        local d = descenders[c] and floor(size/5) or 0
+        characters[c] = {
+            width    = w,
+            height   = h,
+            depth    = d,
+            commands = {
+                { "down", d },
+                { "rule", h + d, w - floor(size/20) },
+                { "right", floor(size/20) },
+            },
+        }
+    end
+    -- a ligature and a few kerns so that the ligkern pass has work to do
+    characters[102].ligatures = { [105] = { char = 12, type = 0 } }
+    characters[65].kerns = { [86] = -floor(size/20), [87] = -floor(size/20) }
+    characters[86].kerns = { [65] = -floor(size/20), [111] = -floor(size/25) }
+    return font.define {
+        name       = name,
+        size       = size,
+        type       = "virtual",
+        fonts      = { { id = 0 } },
+        hyphenchar = 45,
+        characters = characters,
+        parameters = parameters(size,extra),
+    }
+end
+
+-- the text font is \benchrm, the others are selected by id with \setfontid
+
+function bench.setupfonts(n)
+    tex.definefont(true, "benchrm", bench.definefont("benchfont-rm", 10 * 65536, 0))
+    bench.fontids = { }
+    for i=1,n do
+        bench.fontids[i] = bench.definefont("benchfont-" .. i, (8 + i % 8) * 65536, i)
+    end
+end
+
+function bench.setupmath()
+    local size = 10 * 65536
+    tex.definefont(true, "benchmathtext",     bench.definefont("benchmath-text",size,1))
+    tex.definefont(true, "benchmathsymbol",   bench.definefont("benchmath-symbol",size,2,symbolparameters))
+    tex.definefont(true, "benchmathssymbol",  bench.definefont("benchmath-ssymbol",floor(size*0.7),2,symbolparameters))
+    tex.definefont(true, "benchmathsssymbol", bench.definefont("benchmath-sssymbol",floor(size*0.5),2,symbolparameters))
+    tex.definefont(true, "benchmathext",      bench.definefont("benchmath-ext",size,3,extensionparameters))
+    for fam=0,1 do
+        tex.sprint(format("\\global\\textfont%i=\\benchmathtext \\global\\scriptfont%i=\\benchmathtext \\global\\scriptscriptfont%i=\\benchmathtext ",fam,fam,fam))
+    end
+    tex.sprint("\\global\\textfont2=\\benchmathsymbol \\global\\scriptfont2=\\benchmathssymbol \\global\\scriptscriptfont2=\\benchmathsssymbol ")
+    tex.sprint("\\global\\textfont3=\\benchmathext \\global\\scriptfont3=\\benchmathext \\global\\scriptscriptfont3=\\benchmathext ")
+end
+
+-- hyphenation: a break after every vowel that is followed by a consonant
+
+function bench.setuplanguage()
+    local l = lang.new()
+    local patterns = { }
+    for v in string.gmatch("aeiou",".") do
+        for c in string.gmatch("bcdfglmnprstv",".") do
+            patterns[#patterns+1] = v .. "1" .. c
+        end
+    end
+    l:patterns(concat(patterns," "))
+    tex.language = l:id()
+    tex.lefthyphenmin = 2
+    tex.righthyphenmin = 3
+end
+
+-- text
+
+local syllables = {
+    "ba", "ce", "di", "fo", "gu", "la", "me", "ni", "po", "ru", "sa", "te",
+    "vi", "ton", "mar", "les", "fi", "AV", "ro", "ga", "bel", "du", "ver", "ni",
+}
+
+function bench.word()
+    local n = 1 + bench.random(5)
+    local w = { }
+    for i=1,n do
+        w[i] = syllables[1 + bench.random(#syllables)]
+    end
+    return concat(w)
+end
+
+function bench.sentence(n)
+    local s = { }
+    for i=1,n do
+        s[i] = bench.word()
+    end
+    return concat(s," ") .. "."
+end
+
+function bench.paragraph(n)
+    local s = { }
+    for i=1,n do
+        s[i] = bench.sentence(8 + bench.random(12))
+    end
+    return concat(s," ")
+end
+
+-- scenarios, the amount of work is multiplied by LUATEX_BENCH_SCALE
+
+local function times(n)
+    return floor(n * bench.scale + 0.5)
+end
+
+function bench.text(n)
+    for i=1,times(n) do
+        tex.print(bench.paragraph(6))
+        tex.print("")
+    end
+end
+
+local formulas = {
+    "$a_{i}^{2}+b_{j}^{2}=c_{k}^{2}$",
+    "${x+y\\over z-1}$",
+    "$\\sqrt{x^{2}+1}$",
+    "$f(x)=\\left(a+{b\\over c}\\right)^{n}$",
+    "$$\\sum_{k=0}^{n} a_{k}x^{k} = {p(x)\\over q(x)}$$",
+    "$$\\left(\\sum_{i=1}^{m} {x_{i}^{2}\\over y_{i}}\\right)^{1\\over 2}$$",
+}
+
+function bench.math(n)
+    for i=1,times(n) do
+        local s = { }
+        for j=1,8 do
+            s[#s+1] = bench.sentence(4 + bench.random(6))
+            s[#s+1] = formulas[1 + bench.random(#formulas)]
+        end
+        tex.print(concat(s," "))
+        tex.print("")
+    end
+end
+
+function bench.table(rows,columns)
+    tex.print("\\halign{#\\hfil\\tabskip10pt&&\\hfil#\\cr")
+    for i=1,times(rows) do
+        local r = { bench.word() }
+        for j=2,columns do
+            r[j] = tostring(bench.random(100000))
+        end
+        tex.print(concat(r,"&") .. "\\cr")
+    end
+    tex.print("}")
+end
+
+local images = { "1-4.jpg", "B.pdf", "lily-ledger-broken.png" }
+
+function bench.images(n)
+    for i=1,times(n) do
+        for j=1,#images do
+            tex.print("\\pdfximage width 80pt {" .. images[j] .. "}\\pdfrefximage\\pdflastximage")
+        end
+        tex.print("\\par\\vfill\\eject")
+    end
+end
+
+function bench.fonts(n)
+    local fonts = bench.fontids
+    for i=1,times(n) do
+        local s = { }
+        for j=1,80 do
+            s[j] = "\\setfontid" .. fonts[1 + bench.random(#fonts)] .. " " .. bench.word()
+        end
+        tex.print(concat(s," "))
+        tex.print("")
+    end
+end
+
+-- callbacks that visit every node, like the node processing in a macro package
+
+function bench.callbacks()
+    local direct      = node.direct
+    local todirect    = direct.todirect
+    local getnext     = direct.getnext
+    local getid       = direct.getid
+    local getlist     = direct.getlist
+    local setattr     = direct.set_attribute
+    local glyph_code  = node.id("glyph")
+    local hlist_code  = node.id("hlist")
+    local glyphs      = 0
+    local function mark(head)
+        local n = todirect(head)
+        while n do
+            local id = getid(n)
+            if id == glyph_code then
+                setattr(n,1,glyphs % 7)
+                glyphs = glyphs + 1
+            elseif id == hlist_code then
+                mark(getlist(n))
+            end
+            n = getnext(n)
+        end
+        return true
+    end
+    callback.register("pre_linebreak_filter", mark)
+    callback.register("post_linebreak_filter", mark)
+    callback.register("hpack_filter", mark)
+    callback.register("pre_output_filter", mark)
+end
+
+-- measuring
+
+local starttime, startclock
+
+function bench.start(name)
+    bench.name = name
+    if os.getenv("LUATEX_BENCH_TIMERS") and status.enabletimers then
+        status.resettimers()
+        status.enabletimers(true)
+    end
+    callback.register("wrapup_run",bench.report)
+    starttime = os.gettimeofday()
+    startclock = os.clock()
+end
+
+local function peakrss()
+    local f = io.open("/proc/self/status")
+    if f then
+        local s = f:read("*a")
+        f:close()
+        return tonumber(string.match(s,"VmHWM:%s*(%d+)"))
+    end
+end
+
+local function number(n)
+    return n and format("%.6f",n) or "null"
+end
+
+local function integer(n)
+    return n and format("%d",n) or "null"
+end
+
+function bench.report()
+    local wall   = os.gettimeofday() - starttime
+    local cpu    = os.clock() - startclock
+    local pages  = status.total_pages
+    local output = status.output_file_name
+    local bytes  = output and lfs.attributes(output,"size")
+    local fields = {
+        format('"scenario":"%s"',bench.name),
+        format('"scale":%s',number(bench.scale)),
+        format('"pages":%d',pages),
+        format('"wall":%s',number(wall)),
+        format('"cpu":%s',number(cpu)),
+        format('"pages_per_second":%s',number(wall > 0 and pages/wall or nil)),
+        format('"peak_rss_kb":%s',integer(peakrss())),
+        format('"var_mem_max":%s',integer(status.var_mem_max)),
+        format('"output_bytes":%s',integer(bytes)),
+    }
+    local timers = status.timers_enabled and status.timers
+    if timers then
+        local t = { }
+        for k, v in next, timers do
+            t[#t+1] = format('"%s":{"calls":%d,"cpu":%s,"wall":%s}',k,v.calls,number(v.cpu),number(v.wall))
+        end
+        table.sort(t)
+        fields[#fields+1] = '"timers":{' .. concat(t,",") .. '}'
+    end
+    local f = io.open(bench.output,"a")
+    if f then
+        f:write("{",concat(fields,","),"}\n")
+        f:close()
+    end
+end
+
+return bench
@@ -357,6 +357,7 @@ void build_page(void)
     int id, sk, i;
     if ((vlink(contrib_head) == null) || output_active)
         return;
+    phase_timer_start(buildpage_timer);
     do {
       CONTINUE:
         p = vlink(contrib_head);
@@ -778,7 +779,7 @@ void build_page(void)
     /*tex Make the contribution list empty by setting its tail to |contrib_head|. */
     contrib_tail = contrib_head;
   EXIT:
-    ;
+    phase_timer_stop(buildpage_timer);
 }
 
 /*tex
@@ -32,7 +32,7 @@ with LuaTeX; if not, see <http://www.gnu.org/licenses/>.
 
 */
 
-#define FORMAT_ID (907+58)
+#define FORMAT_ID (907+61)
 #if ((FORMAT_ID>=0) && (FORMAT_ID<=256))
 #error Wrong value for FORMAT_ID.
 #endif
@@ -163,7 +163,10 @@ void store_fmt_file(void)
         We recompute |var_used| and |dyn_used|, so that \.{INITEX} dumps valid
         information even when it has not been gathering statistics.
     */
+    flush_extensible_cache();
+    flush_math_cache();
     dump_node_mem();
+    flush_pending_lists();
     dump_int(temp_token_head);
     dump_int(hold_token_head);
     dump_int(omit_template);
@@ -75,6 +75,81 @@ with LuaTeX; if not, see <http://www.gnu.org/licenses/>.
 
 halfword just_box;
 
+/*tex
+
+    All the variables that the breaker needs while it works on a paragraph are
+    kept together in a |linebreak_state|. The names that the original program
+    uses for them are mapped onto the current state by macros, so the code below
+    reads as before. Each call to |ext_do_line_break| gets its own state, as
+    well as its own head of the active list, which makes the breaker reentrant:
+    a callback that runs during |post_line_break| (for instance when a line gets
+    packaged) can break another paragraph with |tex.linebreak| without damaging
+    the active and passive lists of the paragraph that is being finished.
+
+*/
+
+typedef struct linebreak_state {
+    halfword active_head;
+    boolean no_shrink_error_yet;
+    boolean second_pass;
+    boolean final_pass;
+    int threshold;
+    int max_stretch_ratio;
+    int max_shrink_ratio;
+    int cur_font_step;
+    halfword passive;
+    halfword printed_node;
+    halfword pass_number;
+    scaled active_width[10];
+    scaled background[10];
+    scaled break_width[10];
+    boolean auto_breaking;
+    int internal_pen_inter;
+    int internal_pen_broken;
+    halfword internal_left_box;
+    int internal_left_box_width;
+    halfword init_internal_left_box;
+    int init_internal_left_box_width;
+    halfword internal_right_box;
+    int internal_right_box_width;
+    scaled disc_width[10];
+    int minimal_demerits[4];
+    int minimum_demerits;
+    halfword best_place[4];
+    halfword best_pl_line[4];
+    halfword easy_line;
+    halfword last_special_line;
+    scaled first_width;
+    scaled second_width;
+    scaled first_indent;
+    scaled second_indent;
+    halfword best_bet;
+    int fewest_demerits;
+    halfword best_line;
+    int actual_looseness;
+    int line_diff;
+    boolean do_last_line_fit;
+    scaled fill_width[4];
+    scaled best_pl_short[4];
+    scaled best_pl_glue[4];
+    halfword free_active;
+    halfword free_passive;
+    halfword free_delta;
+} linebreak_state;
+
+/*tex The state of the paragraph that is being broken, |NULL| when idle: */
+
+static linebreak_state *lb_state = NULL;
+
+/*tex The head of the active list, see |initialize_active|: */
+
+#define active_head (lb_state->active_head)
+
+/*tex The outcome of the last paragraph, for |get_linebreak_info|: */
+
+static int last_fewest_demerits = 0;
+static int last_actual_looseness = 0;
+
 /*tex
 
     In it's complete form, |line_break| is a rather lengthy procedure---sort of a
@@ -214,7 +289,7 @@ void line_break(boolean d, int line_break_context)
 
 /*tex Have we complained about infinite shrinkage? */
 
-static boolean no_shrink_error_yet;
+#define no_shrink_error_yet (lb_state->no_shrink_error_yet)
 
 /*tex Recovers from infinite shrinkage. */
 
@@ -263,15 +338,15 @@ static halfword finite_shrink(halfword p)
 
 /*tex is this our second attempt to break this paragraph? */
 
-static boolean second_pass;
+#define second_pass (lb_state->second_pass)
 
 /*tex is this our final attempt to break this paragraph? */
 
-static boolean final_pass;
+#define final_pass (lb_state->final_pass)
 
 /*tex maximum badness on feasible lines */
 
-static int threshold;
+#define threshold (lb_state->threshold)
 
 /*tex
 
@@ -308,15 +383,15 @@ static halfword pop_node(void)
 
 /*tex maximal stretch ratio of expanded fonts */
 
-static int max_stretch_ratio = 0;
+#define max_stretch_ratio (lb_state->max_stretch_ratio)
 
 /*tex maximal shrink ratio of expanded fonts */
 
-static int max_shrink_ratio = 0;
+#define max_shrink_ratio (lb_state->max_shrink_ratio)
 
 /*tex the current step of expanded fonts */
 
-static int cur_font_step = 0;
+#define cur_font_step (lb_state->cur_font_step)
 
 static boolean check_expand_pars(internal_font_number f)
 {
@@ -534,6 +609,10 @@ typedef enum {
     except that nodes with |line_number>easy_line| may be in any order relative
     to each other.
 
+    The outermost paragraph uses the fixed |active| node as head, a paragraph
+    that is broken while another one is still in progress gets a fresh one,
+    which is why the code below uses |active_head|.
+
 */
 
 void initialize_active(void)
@@ -591,15 +670,15 @@ void initialize_active(void)
 
 /*tex most recent node on passive list */
 
-static halfword passive;
+#define passive (lb_state->passive)
 
 /*tex most recent node that has been printed */
 
-static halfword printed_node;
+#define printed_node (lb_state->printed_node)
 
 /*tex the number of passive nodes allocated on this pass */
 
-static halfword pass_number;
+#define pass_number (lb_state->pass_number)
 
 /*tex
 
@@ -643,19 +722,19 @@ static halfword pass_number;
 
 /*tex distance from first active node to~|cur_p| */
 
-static scaled active_width[10] = { 0 };
+#define active_width (lb_state->active_width)
 
 /*tex length of an ``empty'' line */
 
-static scaled background[10] = { 0 };
+#define background (lb_state->background)
 
 /*tex length being computed after current break */
 
-static scaled break_width[10] = { 0 };
+#define break_width (lb_state->break_width)
 
 /*tex Make |auto_breaking| accessible out of |line_break|: */
 
-static boolean auto_breaking;
+#define auto_breaking (lb_state->auto_breaking)
 
 /*tex
 
@@ -715,39 +794,39 @@ static boolean auto_breaking;
 
 /*tex running \.{\\localinterlinepenalty} */
 
-static int internal_pen_inter;
+#define internal_pen_inter (lb_state->internal_pen_inter)
 
 /*tex running \.{\\localbrokenpenalty} */
 
-static int internal_pen_broken;
+#define internal_pen_broken (lb_state->internal_pen_broken)
 
 /*tex running \.{\\localleftbox} */
 
-static halfword internal_left_box;
+#define internal_left_box (lb_state->internal_left_box)
 
 /*tex running \.{\\localleftbox} width */
 
-static int internal_left_box_width;
+#define internal_left_box_width (lb_state->internal_left_box_width)
 
 /*tex running \.{\\localleftbox} */
 
-static halfword init_internal_left_box;
+#define init_internal_left_box (lb_state->init_internal_left_box)
 
 /*tex running \.{\\localleftbox} width */
 
-static int init_internal_left_box_width;
+#define init_internal_left_box_width (lb_state->init_internal_left_box_width)
 
 /*tex running \.{\\localrightbox} */
 
-static halfword internal_right_box;
+#define internal_right_box (lb_state->internal_right_box)
 
 /*tex running \.{\\localrightbox} width */
 
-static int internal_right_box_width;
+#define internal_right_box_width (lb_state->internal_right_box_width)
 
 /*tex the length of discretionary material preceding a break */
 
-static scaled disc_width[10] = { 0 };
+#define disc_width (lb_state->disc_width)
 
 /*tex
 
@@ -768,19 +847,19 @@ static scaled disc_width[10] = { 0 };
 
 /*tex best total demerits known for current line class and position, given the fitness */
 
-static int minimal_demerits[4];
+#define minimal_demerits (lb_state->minimal_demerits)
 
 /*tex best total demerits known for current line class and position */
 
-static int minimum_demerits;
+#define minimum_demerits (lb_state->minimum_demerits)
 
 /*tex how to achieve  |minimal_demerits| */
 
-static halfword best_place[4];
+#define best_place (lb_state->best_place)
 
 /*tex corresponding line number */
 
-static halfword best_pl_line[4];
+#define best_pl_line (lb_state->best_pl_line)
 
 /*tex
 
@@ -802,47 +881,47 @@ static halfword best_pl_line[4];
 
 /*tex line numbers |>easy_line| are equivalent in break nodes */
 
-static halfword easy_line;
+#define easy_line (lb_state->easy_line)
 
 /*tex line numbers |>last_special_line| all have the same width */
 
-static halfword last_special_line;
+#define last_special_line (lb_state->last_special_line)
 
 /*tex the width of all lines |<=last_special_line|, if no \.{\\parshape} has been specified */
 
-static scaled first_width;
+#define first_width (lb_state->first_width)
 
 /*tex the width of all lines |>last_special_line| */
 
-static scaled second_width;
+#define second_width (lb_state->second_width)
 
 /*tex left margin to go with |first_width| */
 
-static scaled first_indent;
+#define first_indent (lb_state->first_indent)
 
 /*tex left margin to go with |second_width| */
 
-static scaled second_indent;
+#define second_indent (lb_state->second_indent)
 
 /*tex use this passive node and its predecessors */
 
-static halfword best_bet;
+#define best_bet (lb_state->best_bet)
 
 /*tex the demerits associated with |best_bet| */
 
-static int fewest_demerits;
+#define fewest_demerits (lb_state->fewest_demerits)
 
 /*tex line number following the last line of the new paragraph */
 
-static halfword best_line;
+#define best_line (lb_state->best_line)
 
 /*tex the difference between |line_number(best_bet)| and the optimum |best_line| */
 
-static int actual_looseness;
+#define actual_looseness (lb_state->actual_looseness)
 
 /*tex the difference between the current line number and the optimum |best_line| */
 
-static int line_diff;
+#define line_diff (lb_state->line_diff)
 
 /*tex
 
@@ -887,39 +966,116 @@ static int line_diff;
         active_width[1] += surround(cur_p); \
 }
 
-#define clean_up_the_memory() { \
-    q=vlink(active); \
-    while (q!=active) { \
-        cur_p = vlink(q); \
-        if (type(q)==delta_node) \
-            flush_node(q); \
-        else \
-            flush_node(q); \
-        q = cur_p; \
-    } \
-    q = passive;  \
-    while (q!=null) { \
-        cur_p = vlink(q); \
-        flush_node(q); \
-        q = cur_p; \
-    } \
+/*tex
+
+    Active, passive and delta nodes only live as long as the paragraph is being
+    broken, and many of them are created and deactivated during a pass. Instead
+    of going through |new_node| and |flush_node| for each of them, the breaker
+    keeps the ones that it no longer needs on a free list per kind and takes new
+    ones from there. When a pass fails all break nodes go to these lists, and
+    only when the paragraph is done they are returned to node memory, a list at
+    a time.
+
+*/
+
+#define free_active  (lb_state->free_active)
+#define free_passive (lb_state->free_passive)
+#define free_delta   (lb_state->free_delta)
+
+static halfword new_break_node(int t, int s)
+{
+    halfword p;
+    int size;
+    if (t == delta_node) {
+        size = delta_node_size;
+        p = free_delta;
+        if (p != null)
+            free_delta = vlink(p);
+    } else if (t == passive_node) {
+        size = passive_node_size;
+        p = free_passive;
+        if (p != null)
+            free_passive = vlink(p);
+    } else {
+        size = active_node_size;
+        p = free_active;
+        if (p != null)
+            free_active = vlink(p);
+    }
+    if (p == null)
+        p = get_node(size);
+    (void) memset((void *) (varmem + p + 1), 0, (sizeof(memory_word) * ((unsigned) size - 1)));
+    type(p) = (quarterword) t;
+    subtype(p) = (quarterword) s;
+    vlink(p) = null;
+    return p;
+}
+
+static void free_break_node(halfword p)
+{
+    if (type(p) == delta_node) {
+        vlink(p) = free_delta;
+        free_delta = p;
+    } else if (type(p) == passive_node) {
+        vlink(p) = free_passive;
+        free_passive = p;
+    } else {
+        vlink(p) = free_active;
+        free_active = p;
+    }
+}
+
+/*tex Move the active and passive lists to the free lists, after a pass. */
+
+static void recycle_break_nodes(void)
+{
+    halfword q = vlink(active_head);
+    while (q != active_head) {
+        halfword r = vlink(q);
+        free_break_node(q);
+        q = r;
+    }
+    vlink(active_head) = active_head;
+    q = passive;
+    while (q != null) {
+        halfword r = vlink(q);
+        free_break_node(q);
+        q = r;
+    }
+    passive = null;
+}
+
+/*tex Give all break nodes back to node memory, after the paragraph. */
+
+static void release_break_nodes(void)
+{
+    recycle_break_nodes();
+    if (free_active != null)
+        free_node_chain(free_active, active_node_size);
+    if (free_passive != null)
+        free_node_chain(free_passive, passive_node_size);
+    if (free_delta != null)
+        free_node_chain(free_delta, delta_node_size);
+    free_active = null;
+    free_passive = null;
+    free_delta = null;
 }
 
 /*tex special algorithm for last line of paragraph? */
 
-static boolean do_last_line_fit;
+#define do_last_line_fit (lb_state->do_last_line_fit)
 
 /*tex infinite stretch components of  |par_fill_skip| */
 
-static scaled fill_width[4];
+#define fill_width (lb_state->fill_width)
 
 /*tex |shortfall|  corresponding to |minimal_demerits| */
 
-static scaled best_pl_short[4];
+#define best_pl_short (lb_state->best_pl_short)
 
 /*tex corresponding glue stretch or shrink */
 
-static scaled best_pl_glue[4];
+#define best_pl_glue (lb_state->best_pl_glue)
 
 #define reset_disc_width(a) disc_width[(a)] = 0
 
@@ -1282,7 +1438,7 @@ static void ext_try_break(
     scaled margin_kern_shrink;
     halfword lp, rp, cp;
     /*tex stays a step behind |r| */
-    halfword prev_r = active;
+    halfword prev_r = active_head;
     /*tex a step behind |prev_r|, if |type(prev_r)=delta_node| */
     halfword prev_prev_r = null;
     /*tex maximum line number in current equivalence class of lines */
@@ -1355,7 +1511,7 @@ static void ext_try_break(
         if (l > old_l) {
             /*tex now we are no longer in the inner loop */
             if ((minimum_demerits < awful_bad)
-                && ((old_l != easy_line) || (r == active))) {
+                && ((old_l != easy_line) || (r == active_head))) {
                 /*tex
 
                     Create new active nodes for the best feasible breaks just
@@ -1381,11 +1537,11 @@ static void ext_try_break(
                 if (type(prev_r) == delta_node) {
                     /*tex modify an existing delta node */
                     do_all_eight(convert_to_break_width);
-                } else if (prev_r == active) {
+                } else if (prev_r == active_head) {
                     /*tex no delta node needed at the beginning */
                     do_all_eight(store_break_width);
                 } else {
-                    q = new_node(delta_node, 0);
+                    q = new_break_node(delta_node, 0);
                     vlink(q) = r;
                     do_all_eight(new_delta_to_break_width);
                     vlink(prev_r) = q;
@@ -1406,7 +1562,7 @@ static void ext_try_break(
                             create the corresponding passive node.
 
                         */
-                        q = new_node(passive_node, 0);
+                        q = new_break_node(passive_node, 0);
                         vlink(q) = passive;
                         passive = q;
                         cur_break(q) = cur_p;
@@ -1433,7 +1589,7 @@ static void ext_try_break(
                         }
                         passive_right_box(q) = internal_right_box;
                         passive_right_box_width(q) = internal_right_box_width;
-                        q = new_node(break_type, fit_class);
+                        q = new_break_node(break_type, fit_class);
                         break_node(q) = passive;
                         line_number(q) = best_pl_line[fit_class] + 1;
                         total_demerits(q) = minimal_demerits[fit_class];
@@ -1465,8 +1621,8 @@ static void ext_try_break(
                     |type(prev_r)<>delta_node|.
 
                 */
-                if (r != active) {
-                    q = new_node(delta_node, 0);
+                if (r != active_head) {
+                    q = new_break_node(delta_node, 0);
                     vlink(q) = r;
                     do_all_eight(new_delta_from_break_width);
                     vlink(prev_r) = q;
@@ -1474,7 +1630,7 @@ static void ext_try_break(
                     prev_r = q;
                 }
             }
-            if (r == active)
+            if (r == active_head)
                 return;
             /*tex
 
@@ -1765,7 +1921,7 @@ static void ext_try_break(
 
             */
             if (final_pass && (minimum_demerits == awful_bad) &&
-                (vlink(r) == active) && (prev_r == active)) {
+                (vlink(r) == active_head) && (prev_r == active_head)) {
                 /*tex Set demerits zero, this break is forced. */
                 artificial_demerits = true;
             } else if (b > threshold) {
@@ -1870,8 +2026,8 @@ static void ext_try_break(
 
         */
         vlink(prev_r) = vlink(r);
-        flush_node(r);
-        if (prev_r == active) {
+        free_break_node(r);
+        if (prev_r == active_head) {
             /*tex
 
                 Update the active widths, since the first active node has been
@@ -1881,25 +2037,25 @@ static void ext_try_break(
                 it will be initialized when an active node is next inserted.
 
             */
-            r = vlink(active);
+            r = vlink(active_head);
             if (type(r) == delta_node) {
                 do_all_eight(update_active);
                 do_all_eight(copy_to_cur_active);
-                vlink(active) = vlink(r);
-                flush_node(r);
+                vlink(active_head) = vlink(r);
+                free_break_node(r);
             }
         } else if (type(prev_r) == delta_node) {
             r = vlink(prev_r);
-            if (r == active) {
+            if (r == active_head) {
                 do_all_eight(downdate_width);
-                vlink(prev_prev_r) = active;
-                flush_node(prev_r);
+                vlink(prev_prev_r) = active_head;
+                free_break_node(prev_r);
                 prev_r = prev_prev_r;
             } else if (type(r) == delta_node) {
                 do_all_eight(update_width);
                 do_all_eight(combine_two_deltas);
                 vlink(prev_r) = vlink(r);
-                flush_node(r);
+                free_break_node(r);
             }
         }
     }
@@ -1938,6 +2094,34 @@ void ext_do_line_break(
     /*tex Miscellaneous nodes of temporary interest. */
     halfword cur_p, q, r, s;
     int line_break_dir = paragraph_dir;
+    /*tex The state of this paragraph and that of the one we interrupt, if any. */
+    linebreak_state state;
+    linebreak_state *saved_state = lb_state;
+    halfword saved_dir_ptr = dir_ptr;
+    halfword saved_just_box = just_box;
+    halfword saved_adjust_list = vlink(adjust_head);
+    halfword saved_adjust_tail = adjust_tail;
+    halfword saved_pre_adjust_list = vlink(pre_adjust_head);
+    halfword saved_pre_adjust_tail = pre_adjust_tail;
+    phase_timer_start(linebreak_timer);
+    memset(&state, 0, sizeof(linebreak_state));
+    lb_state = &state;
+    if (saved_state == NULL) {
+        active_head = active;
+    } else {
+        /*tex
+
+            We are nested, for instance in a callback issued by the
+            |post_line_break| of another paragraph, so we need our own head,
+            directions and adjust lists.
+
+        */
+        active_head = new_node(hyphenated_node, 0);
+        line_number(active_head) = max_halfword;
+        dir_ptr = null;
+        vlink(adjust_head) = null;
+        vlink(pre_adjust_head) = null;
+    }
     /*tex Get ready to start */
     minimum_demerits = awful_bad;
     minimal_demerits[tight_fit] = awful_bad;
@@ -2069,14 +2253,14 @@ void ext_do_line_break(
         if (threshold > inf_bad)
             threshold = inf_bad;
         /*tex Create an active breakpoint representing the beginning of the paragraph. */
-        q = new_node(unhyphenated_node, decent_fit);
-        vlink(q) = active;
+        q = new_break_node(unhyphenated_node, decent_fit);
+        vlink(q) = active_head;
         break_node(q) = null;
         line_number(q) = cur_list.pg_field + 1;
         total_demerits(q) = 0;
         active_short(q) = 0;
         active_glue(q) = 0;
-        vlink(active) = q;
+        vlink(active_head) = q;
         do_all_eight(store_background);
         passive = null;
         printed_node = temp_head;
@@ -2116,7 +2300,7 @@ void ext_do_line_break(
             |break_node=null|.
 
         */
-        while ((cur_p != null) && (vlink(active) != active)) {
+        while ((cur_p != null) && (vlink(active_head) != active_head)) {
             /*tex
 
                 |try_break| if |cur_p| is a legal breakpoint; on the 2nd pass,
@@ -2399,9 +2583,9 @@ void ext_do_line_break(
                           tracing_paragraphs, protrude_chars, line_penalty,
                           last_line_fit, double_hyphen_demerits,
                           final_hyphen_demerits, first_p, cur_p);
-            if (vlink(active) != active) {
+            if (vlink(active_head) != active_head) {
                 /*tex Find an active node with fewest demerits; */
-                r = vlink(active);
+                r = vlink(active_head);
                 fewest_demerits = awful_bad;
                 do {
                     if (type(r) != delta_node) {
@@ -2411,7 +2595,7 @@ void ext_do_line_break(
                         }
                     }
                     r = vlink(r);
-                } while (r != active);
+                } while (r != active_head);
                 best_line = line_number(best_bet);
                 /*tex
                     Find an active node with fewest demerits;
@@ -2429,7 +2613,7 @@ void ext_do_line_break(
                     independently of the other segments.
 
                 */
-                r = vlink(active);
+                r = vlink(active_head);
                 actual_looseness = 0;
                 do {
                     if (type(r) != delta_node) {
@@ -2448,7 +2632,7 @@ void ext_do_line_break(
                         }
                     }
                     r = vlink(r);
-                } while (r != active);
+                } while (r != active_head);
                 best_line = line_number(best_bet);
                 /*tex
                     Find the best active node for the desired looseness.
@@ -2457,9 +2641,8 @@ void ext_do_line_break(
                     goto DONE;
             }
         }
-        /*tex Clean up the memory by removing the break nodes. */
-        clean_up_the_memory();
-        /*tex Clean up the memory by removing the break nodes. */
+        /*tex Keep the break nodes around for the next pass. */
+        recycle_break_nodes();
         if (!second_pass) {
             if (tracing_paragraphs > 0)
                 tprint_nl("@secondpass");
@@ -2527,11 +2710,25 @@ void ext_do_line_break(
         Clean up the memory by removing the break nodes.
 
     */
-    clean_up_the_memory();
+    release_break_nodes();
+    last_fewest_demerits = fewest_demerits;
+    last_actual_looseness = actual_looseness;
+    if (saved_state != NULL) {
+        flush_node(active_head);
+        flush_node_list(dir_ptr);
+        dir_ptr = saved_dir_ptr;
+        just_box = saved_just_box;
+        vlink(adjust_head) = saved_adjust_list;
+        adjust_tail = saved_adjust_tail;
+        vlink(pre_adjust_head) = saved_pre_adjust_list;
+        pre_adjust_tail = saved_pre_adjust_tail;
+    }
+    lb_state = saved_state;
+    phase_timer_stop(linebreak_timer);
 }
 
 void get_linebreak_info (int *f, int *a)
 {
-    *f = fewest_demerits;
-    *a = actual_looseness;
+    *f = last_fewest_demerits;
+    *a = last_actual_looseness;
 }
@@ -392,6 +392,7 @@ int main_initialize(void)
     setup_bound_var(10000, "expand_depth", expand_depth);
     setup_bound_var(0, "level_max", level_max);
     setup_bound_var('.', "level_chr", level_chr);
+    setup_bound_var(0, "mapped_input", mapped_input);
     /*tex
         Check other constants against their sup and inf.
     */
@@ -655,6 +656,10 @@ void close_files_and_terminate(void)
         dummy in \DVI.
     */
     wrapup_backend();
+    /*tex
+        The backend is done so we can write the last telemetry record.
+    */
+    close_telemetry();
     /*tex
         Close {\sl Sync\TeX} file and write status.
     */
@@ -120,9 +120,26 @@ static void run_char_num (void) {
     tail_append(new_char(cur_font_par, cur_chr));
 }
 
+/*tex
+
+    After a character we take the run of plain characters that follows on the
+    current input line in one go, as |get_x_token| would just return them one
+    by one. When commands are traced or an interrupt is pending we stay on the
+    normal route.
+
+*/
+
 static void run_char (void) {
     adjust_space_factor();
     tail_append(new_char(cur_font_par, cur_chr));
+    if (tracing_commands_par <= 0 && interrupt == 0) {
+        int n = plain_char_run();
+        while (n-- > 0) {
+            cur_chr = buffer[iloc++];
+            adjust_space_factor();
+            tail_append(new_char(cur_font_par, cur_chr));
+        }
+    }
 }
 
 static void run_node (void) {
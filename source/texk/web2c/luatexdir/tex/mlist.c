@@ -1274,7 +1274,7 @@ static pointer get_delim_box(internal_font_number fnt, halfword chr, scaled v, s
     return make_extensible(fnt, chr, v, min_overlap, horizontal, att);
 }
 
-pointer make_extensible(internal_font_number fnt, halfword chr, scaled v, scaled min_overlap, int horizontal, halfword att)
+static pointer build_extensible(internal_font_number fnt, halfword chr, scaled v, scaled min_overlap, int horizontal, halfword att)
 {
     /*tex new box */
     pointer b;
@@ -1487,6 +1487,99 @@ pointer make_extensible(internal_font_number fnt, halfword chr, scaled v, scaled
     return b;
 }
 
+/*tex
+
+    Formulas with many fences or radicals of the same size ask for the same
+    extensibles over and over, so we keep the most recent ones. The key has all
+    that goes into the box: the recipe and requested size, the direction and
+    italic mode that apply to the char boxes, and the font generation, that
+    changes when character data is (re)defined. The kept lists have no
+    attributes. All nodes in the copy get |att| when given and the current
+    attributes otherwise, just like a freshly built one, where the char boxes and
+    glue inherit the attributes of the outer box. When \SYNCTEX\ is active we
+    don't cache, because boxes and glue carry a line number.
+
+*/
+
+#define extensible_cache_size 256
+
+typedef struct extensible_cache_entry {
+    internal_font_number fnt;
+    halfword chr;
+    scaled v;
+    scaled min_overlap;
+    int horizontal;
+    int direction;
+    int italics;
+    int generation;
+    pointer list;
+} extensible_cache_entry;
+
+static extensible_cache_entry extensible_cache[extensible_cache_size];
+
+void flush_extensible_cache(void)
+{
+    int i;
+    for (i = 0; i < extensible_cache_size; i++) {
+        if (extensible_cache[i].list != null) {
+            flush_node_list(extensible_cache[i].list);
+            extensible_cache[i].list = null;
+        }
+    }
+}
+
+static void set_extensible_attributes(pointer p, halfword att)
+{
+    while (p != null) {
+        reset_attributes(p, att);
+        if (type(p) == hlist_node || type(p) == vlist_node) {
+            set_extensible_attributes(list_ptr(p), att);
+        }
+        p = vlink(p);
+    }
+}
+
+pointer make_extensible(internal_font_number fnt, halfword chr, scaled v, scaled min_overlap, int horizontal, halfword att)
+{
+    extensible_cache_entry *e;
+    pointer b;
+    int italics;
+    unsigned h;
+    if (synctex_par || synctex_get_mode()) {
+        return build_extensible(fnt, chr, v, min_overlap, horizontal, att);
+    }
+    italics = do_new_math_but_not(fnt);
+    /*tex Sizes are often whole points, so the low bits of |v| are zero. */
+    h = ((unsigned) fnt * 31 + (unsigned) chr) * 31 + (unsigned) v + ((unsigned) v >> 16);
+    e = &extensible_cache[(h ^ (h >> 8)) % extensible_cache_size];
+    if (e->list != null && e->fnt == fnt && e->chr == chr && e->v == v && e->min_overlap == min_overlap
+            && e->horizontal == horizontal && e->direction == text_direction_par && e->italics == italics
+            && e->generation == font_generation) {
+        b = copy_node_list(e->list);
+    } else {
+        b = build_extensible(fnt, chr, v, min_overlap, horizontal, null);
+        set_extensible_attributes(b, null);
+        if (e->list != null) {
+            flush_node_list(e->list);
+            e->list = null;
+        }
+        /*tex An empty box signals an error, which can be corrected next time. */
+        if (list_ptr(b) != null) {
+            e->fnt = fnt;
+            e->chr = chr;
+            e->v = v;
+            e->min_overlap = min_overlap;
+            e->horizontal = horizontal;
+            e->direction = text_direction_par;
+            e->italics = italics;
+            e->generation = font_generation;
+            e->list = copy_node_list(b);
+        }
+    }
+    set_extensible_attributes(b, att != null ? att : current_attribute_list());
+    return b;
+}
+
 /*tex
 
     The |var_delimiter| function, which finds or constructs a sufficiently large
@@ -1854,6 +1947,218 @@ static void math_kern(pointer p, scaled m)
     }
 }
 
+/*tex
+
+    Documents repeat the same small formulas, like $x$ or $f(x)$, over and over,
+    so when \.{\\mathcachemode} is positive we keep the most recent results of
+    |mlist_to_hlist|. Only lists made of simple noads with character or sub
+    mlist kernels and style nodes are kept, and all their nodes must have the
+    same attributes. The key is the structure of the list plus everything else
+    that goes into the result: the style, the penalty flag, the attributes of
+    the noads and the current ones (new nodes get those), the font and math data
+    generations and a double hash of the integer, dimension and glue parameters.
+    The \.{\\mathcode}s are applied when the noads are made, so they are part of
+    the structure already. We skip the output penalty because it changes with
+    every page and doesn't matter here. Warnings, like for missing characters,
+    are only given when the formula is converted. When \SYNCTEX\ is active or
+    the extensible callback is set we don't cache.
+
+*/
+
+#define math_cache_size 512
+#define math_cache_max_key 1024
+
+typedef struct math_cache_entry {
+    unsigned hash;
+    int size;
+    int *key;
+    halfword attr;
+    halfword current_attr;
+    pointer list;
+} math_cache_entry;
+
+static math_cache_entry math_cache[math_cache_size];
+
+static int math_cache_key[math_cache_max_key];
+static int math_cache_key_size = 0;
+
+static void free_math_cache_entry(math_cache_entry *e)
+{
+    flush_node_list(e->list);
+    delete_attribute_ref(e->attr);
+    delete_attribute_ref(e->current_attr);
+    xfree(e->key);
+    e->list = null;
+}
+
+void flush_math_cache(void)
+{
+    int i;
+    for (i = 0; i < math_cache_size; i++) {
+        if (math_cache[i].list != null) {
+            free_math_cache_entry(&math_cache[i]);
+        }
+    }
+}
+
+static int math_cache_put(int v)
+{
+    if (math_cache_key_size == math_cache_max_key) {
+        return 0;
+    }
+    math_cache_key[math_cache_key_size++] = v;
+    return 1;
+}
+
+static int math_cache_mlist(halfword p, halfword att);
+
+static int math_cache_kernel(halfword k, halfword att)
+{
+    if (k == null) {
+        return math_cache_put(0);
+    } else if (node_attr(k) != att) {
+        return 0;
+    }
+    switch (type(k)) {
+        case math_char_node:
+        case math_text_char_node:
+            return math_cache_put(type(k) + (subtype(k) << 8))
+                && math_cache_put(math_fam(k)) && math_cache_put(math_character(k));
+        case sub_mlist_node:
+            return math_cache_put(type(k) + (subtype(k) << 8))
+                && math_cache_mlist(math_list(k), att);
+    }
+    return 0;
+}
+
+static int math_cache_mlist(halfword p, halfword att)
+{
+    int i;
+    while (p != null) {
+        if (node_attr(p) != att) {
+            return 0;
+        }
+        switch (type(p)) {
+            case simple_noad:
+                if (! math_cache_put(type(p) + (subtype(p) << 8))) {
+                    return 0;
+                }
+                for (i = 4; i < noad_size; i++) {
+                    if (! (math_cache_put(vinfo(p + i)) && math_cache_put(vlink(p + i)))) {
+                        return 0;
+                    }
+                }
+                if (! (math_cache_kernel(nucleus(p), att) && math_cache_kernel(supscr(p), att)
+                        && math_cache_kernel(subscr(p), att))) {
+                    return 0;
+                }
+                break;
+            case style_node:
+                if (! math_cache_put(type(p) + (subtype(p) << 8))) {
+                    return 0;
+                }
+                break;
+            default:
+                return 0;
+        }
+        p = vlink(p);
+    }
+    return math_cache_put(-1);
+}
+
+static void math_cache_mix(unsigned *h, int v)
+{
+    h[0] = (h[0] ^ (unsigned) v) * 16777619U;
+    h[1] = (h[1] ^ (h[1] >> 15)) * 2246822519U + (unsigned) v;
+}
+
+static int math_cache_make_key(halfword p, boolean penalties, int mstyle, halfword current)
+{
+    unsigned h[2] = { 2166136261U, 0 };
+    int i;
+    math_cache_key_size = 0;
+    if (! math_cache_mlist(p, node_attr(p))) {
+        return 0;
+    }
+    for (i = 0; i < int_pars; i++) {
+        if (i != output_penalty_code) {
+            math_cache_mix(h, int_par(i));
+        }
+    }
+    for (i = 0; i < dimen_pars; i++) {
+        math_cache_mix(h, dimen_par(i));
+    }
+    for (i = 0; i < glue_pars; i++) {
+        halfword g = glue_par(i);
+        if (g != null) {
+            math_cache_mix(h, width(g));
+            math_cache_mix(h, stretch(g));
+            math_cache_mix(h, shrink(g));
+            math_cache_mix(h, stretch_order(g) + (shrink_order(g) << 8));
+        }
+    }
+    return math_cache_put(mstyle + (penalties ? 256 : 0))
+        && math_cache_put(node_attr(p))
+        && math_cache_put(current)
+        && math_cache_put(font_generation)
+        && math_cache_put(math_data_generation)
+        && math_cache_put((int) h[0])
+        && math_cache_put((int) h[1]);
+}
+
+static unsigned math_cache_hash(void)
+{
+    unsigned h = 2166136261U;
+    int i;
+    for (i = 0; i < math_cache_key_size; i++) {
+        h = (h ^ (unsigned) math_cache_key[i]) * 16777619U;
+    }
+    return h;
+}
+
+static void cached_mlist_to_hlist(halfword p, boolean penalties, int mstyle)
+{
+    math_cache_entry *e;
+    halfword current, q;
+    unsigned h;
+    if (synctex_par || synctex_get_mode() || callback_defined(make_extensible_callback) > 0) {
+        mlist_to_hlist(p, penalties, mstyle);
+        return;
+    }
+    current = current_attribute_list();
+    if (! math_cache_make_key(p, penalties, mstyle, current)) {
+        mlist_to_hlist(p, penalties, mstyle);
+        return;
+    }
+    h = math_cache_hash();
+    e = &math_cache[h % math_cache_size];
+    if (e->list != null && e->hash == h && e->size == math_cache_key_size
+            && memcmp(e->key, math_cache_key, (size_t) math_cache_key_size * sizeof(int)) == 0) {
+        flush_node_list(p);
+        /*tex The copy can grow the node memory, so we don't assign it directly. */
+        q = copy_node_list(e->list);
+        vlink(temp_head) = q;
+        return;
+    }
+    if (e->list != null) {
+        free_math_cache_entry(e);
+    }
+    e->attr = node_attr(p);
+    add_node_attr_ref(e->attr);
+    mlist_to_hlist(p, penalties, mstyle);
+    if (vlink(temp_head) != null) {
+        e->hash = h;
+        e->size = math_cache_key_size;
+        e->key = xmalloc((unsigned) math_cache_key_size * sizeof(int));
+        memcpy(e->key, math_cache_key, (size_t) math_cache_key_size * sizeof(int));
+        e->current_attr = current;
+        add_node_attr_ref(current);
+        e->list = copy_node_list(vlink(temp_head));
+    } else {
+        delete_attribute_ref(e->attr);
+    }
+}
+
 void run_mlist_to_hlist(halfword p, boolean penalties, int mstyle)
 {
     int callback_id;
@@ -1885,7 +2190,11 @@ void run_mlist_to_hlist(halfword p, boolean penalties, int mstyle)
         vlink(temp_head) = a;
         lua_settop(Luas, sfix);
     } else if (callback_id == 0) {
-        mlist_to_hlist(p, penalties, mstyle);
+        if (math_cache_mode_par > 0) {
+            cached_mlist_to_hlist(p, penalties, mstyle);
+        } else {
+            mlist_to_hlist(p, penalties, mstyle);
+        }
     } else {
         vlink(temp_head) = null;
     }
@@ -4373,6 +4682,7 @@ void mlist_to_hlist(pointer mlist, boolean penalties, int cur_style)
     scaled delta;
     /*tex the math unit width corresponding to |cur_size| */
     scaled cur_mu;
+    phase_timer_start(mlist_timer);
     r_subtype = op_noad_type_normal;
     setup_cur_size(cur_style);
     cur_mu = x_over_n(get_math_quad_size(cur_size), 18);
@@ -4837,4 +5147,5 @@ void mlist_to_hlist(pointer mlist, boolean penalties, int cur_style)
         reset_node_properties(r);
         free_node(r, get_node_size(type(r), subtype(r)));
     }
+    phase_timer_stop(mlist_timer);
 }
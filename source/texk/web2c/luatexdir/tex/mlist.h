@@ -36,6 +36,8 @@ extern void fixup_math_parameters(int fam_id, int size_id, int f, int lvl);
 extern scaled get_math_quad_style(int a);
 extern scaled get_math_quad_size(int a);
 
+extern void flush_extensible_cache(void);
+extern void flush_math_cache(void);
 extern pointer make_extensible(internal_font_number fnt, halfword chr, scaled v, scaled min_overlap, int horizontal, halfword att);
 
 #endif
@@ -18,6 +18,7 @@ LuaTeX; if not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "ptexlib.h"
+#include "lua/luatex-api.h"
 
 /*tex
 
@@ -294,34 +295,16 @@ void set_prev_char_p(halfword p)
 scaled char_stretch(halfword p)
 {
     internal_font_number f = font(p);
-    int m = font_max_stretch(f);
-    if (m > 0) {
-        int c = character(p);
-        int ef = get_ef_code(f, c);
-        if (ef > 0) {
-            scaled dw = calc_char_width(f, c, m) - char_width(f, c);
-            if (dw > 0) {
-                return round_xn_over_d(dw, ef, 1000);
-            }
-        }
-    }
+    if (font_max_stretch(f) > 0)
+        return char_expansion_stretch(f, character(p));
     return 0;
 }
 
 scaled char_shrink(halfword p)
 {
     internal_font_number f = font(p);
-    int m = font_max_shrink(f);
-    if (m > 0) {
-        int c = character(p);
-        int ef = get_ef_code(f, c);
-        if (ef > 0) {
-            scaled dw = char_width(f, c) - calc_char_width(f, c, -m);
-            if (dw > 0) {
-                return round_xn_over_d(dw, ef, 1000);
-            }
-        }
-    }
+    if (font_max_shrink(f) > 0)
+        return char_expansion_shrink(f, character(p));
     return 0;
 }
 
@@ -525,6 +508,53 @@ int ignore_math_skip(halfword p)
     return 1;
 }
 
+/*tex
+
+    In horizontal text most of the nodes in a list are glyphs, so |hpack| and
+    |natural_sizes| first handle a run of glyphs in a tight loop that takes the
+    dimensions from the dense metric arrays of the fonts. A glyph with an offset,
+    an expansion or a character beyond the array is measured the usual way. We
+    stop at |pp| or at the first node that is not a glyph. This is only valid
+    when the packing direction is |TLT| or |TRT|.
+
+*/
+
+static halfword pack_glyph_run(halfword p, halfword pp, scaled *w, scaled *h, scaled *d)
+{
+    internal_font_number f = -1;
+    scaled_whd *m = NULL;
+    scaled x = *w;
+    scaled hh = *h;
+    scaled dd = *d;
+    while (p != pp && is_char_node(p)) {
+        int c = character(p);
+        if (font(p) != f) {
+            f = font(p);
+            m = get_metric_cache(f);
+        }
+        if (c >= 0 && c < metric_cache_size && ex_glyph(p) == 0 && y_displace(p) == 0) {
+            scaled_whd *e = &m[c];
+            x += e->wd;
+            if (e->ht > hh)
+                hh = e->ht;
+            if (e->dp > dd)
+                dd = e->dp;
+        } else {
+            scaled_whd whd = pack_width_height_depth(dir_TLT, dir_TRT, p, true);
+            x += whd.wd;
+            if (whd.ht > hh)
+                hh = whd.ht;
+            if (whd.dp > dd)
+                dd = whd.dp;
+        }
+        p = vlink(p);
+    }
+    *w = x;
+    *h = hh;
+    *d = dd;
+    return p;
+}
+
 halfword hpack(halfword p, scaled w, int m, int pack_direction)
 {
     /*tex the box node that will be returned */
@@ -552,6 +582,7 @@ halfword hpack(halfword p, scaled w, int m, int pack_direction)
     scaled font_shrink = 0;
     int adjust_spacing = adjust_spacing_par;
     last_badness = 0;
+    phase_timer_start(hpack_timer);
     /*tex the box node that will be returned */
     r = new_node(hlist_node, min_quarterword);
     if (pack_direction == -1) {
@@ -609,6 +640,9 @@ halfword hpack(halfword p, scaled w, int m, int pack_direction)
             advance |p| to the next node.
 
         */
+        if (m < cal_expand_ratio && dir_TLT_or_TRT(hpack_dir)) {
+            p = pack_glyph_run(p, null, &x, &h, &d);
+        }
         while (is_char_node(p)) {
             /*tex
 
@@ -1023,6 +1057,7 @@ halfword hpack(halfword p, scaled w, int m, int pack_direction)
         pop_dir_node(dir_ptr1);
     /*tex Here we reset the |font_expand_ratio|. */
     font_expand_ratio = 0;
+    phase_timer_stop(hpack_timer);
     return r;
 }
 
@@ -1069,6 +1104,9 @@ scaled_whd natural_sizes(halfword p, halfword pp, glue_ratio g_mult, int g_sign,
         hpack_dir = pack_direction;
     }
     while (p != pp && p != null) {
+        if (dir_TLT_or_TRT(hpack_dir)) {
+            p = pack_glyph_run(p, pp, &siz.wd, &siz.ht, &siz.dp);
+        }
         while (is_char_node(p) && p != pp) {
             whd = pack_width_height_depth(hpack_dir, dir_TRT, p, true);
             siz.wd += whd.wd;
@@ -1204,6 +1242,7 @@ halfword vpackage(halfword p, scaled h, int m, scaled l, int pack_direction)
     /*tex order of infinity */
     int o;
     last_badness = 0;
+    phase_timer_start(vpack_timer);
     r = new_node(vlist_node, 0);
     if (pack_direction == -1) {
         box_dir(r) = body_direction_par;
@@ -1305,7 +1344,7 @@ halfword vpackage(halfword p, scaled h, int m, scaled l, int pack_direction)
         glue_sign(r) = normal;
         glue_order(r) = normal;
         set_glue_ratio_zero(glue_set(r));
-        return r;
+        goto EXIT;
     } else if (x > 0) {
         /*tex
 
@@ -1363,7 +1402,7 @@ halfword vpackage(halfword p, scaled h, int m, scaled l, int pack_direction)
                 }
             }
         }
-        return r;
+        goto EXIT;
     } else {
         /*tex
 
@@ -1437,7 +1476,7 @@ halfword vpackage(halfword p, scaled h, int m, scaled l, int pack_direction)
                 }
             }
         }
-        return r;
+        goto EXIT;
     }
 
   COMMON_ENDING:
@@ -1460,6 +1499,7 @@ halfword vpackage(halfword p, scaled h, int m, scaled l, int pack_direction)
     show_box(r);
     end_diagnostic(true);
   EXIT:
+    phase_timer_stop(vpack_timer);
     return r;
 }
 
@@ -1900,6 +1940,137 @@ halfword vert_break(halfword p, scaled h, scaled d)
 
 /*tex Extract a page of height |h| from box |n|: */
 
+/*tex
+
+    Cutting a long box into many small ones, as in multi-column listings, used
+    to be quadratic: after every |\vsplit| the remainder was packaged again,
+    which means a pass over all the material that is left. For the remainder
+    that we make we therefore also keep, per node, the natural height and the
+    depth so far, and the maximum width from that node onwards. A next split of
+    the same box then only has to walk up to its break. A remainder is always
+    packaged to its natural height, so no glue is set and no warnings can be
+    issued, and these three numbers are all we need.
+
+    The data is tied to one box node. It is dropped when that node is flushed,
+    when the list doesn't start as expected or when \LUA\ code has run in the
+    meantime, because then anything could have happened to the list. With a
+    |vpack_filter| callback we always package the normal way.
+
+*/
+
+halfword split_cache_box = null;
+
+typedef struct split_cache_data {
+    halfword head;
+    int dir;
+    int calls;
+    int first;
+    int count;
+    int size;
+    halfword *nodes;
+    scaled *height;
+    scaled *depth;
+    scaled *width;
+    scaled total_height;
+    scaled total_depth;
+} split_cache_data;
+
+static split_cache_data split_cache = { null, 0, 0, 0, 0, 0, NULL, NULL, NULL, NULL, 0, 0 };
+
+#define lua_call_count() \
+    (callback_count + saved_callback_count + direct_callback_count + late_callback_count + function_callback_count)
+
+static void build_split_cache(halfword p, int vdir)
+{
+    scaled x = 0;
+    scaled d = 0;
+    int k = 0;
+    while (p != null) {
+        scaled w = 0;
+        if (k >= split_cache.size) {
+            split_cache.size = (k < 1000 ? 1000 : 2 * k);
+            split_cache.nodes = xrealloc(split_cache.nodes, (unsigned) split_cache.size * sizeof(halfword));
+            split_cache.height = xrealloc(split_cache.height, (unsigned) split_cache.size * sizeof(scaled));
+            split_cache.depth = xrealloc(split_cache.depth, (unsigned) split_cache.size * sizeof(scaled));
+            split_cache.width = xrealloc(split_cache.width, (unsigned) split_cache.size * sizeof(scaled));
+        }
+        split_cache.nodes[k] = p;
+        split_cache.height[k] = x;
+        split_cache.depth[k] = d;
+        /*tex This follows |vpackage|. */
+        switch (type(p)) {
+            case hlist_node:
+            case vlist_node:
+                {
+                    scaled_whd whd = pack_width_height_depth(vdir, box_dir(p), p, false);
+                    w = whd.wd + shift_amount(p);
+                    x += d + whd.ht;
+                    d = whd.dp;
+                }
+                break;
+            case rule_node:
+            case unset_node:
+                x += d + height(p);
+                d = depth(p);
+                w = width(p);
+                break;
+            case glue_node:
+                x += d;
+                d = 0;
+                x += width(p);
+                if (subtype(p) >= a_leaders)
+                    w = width(leader_ptr(p));
+                break;
+            case kern_node:
+                x += d + width(p);
+                d = 0;
+                break;
+            default:
+                break;
+        }
+        split_cache.width[k] = (w > 0 ? w : 0);
+        p = vlink(p);
+        k++;
+    }
+    split_cache.count = k;
+    while (--k > 0) {
+        if (split_cache.width[k] > split_cache.width[k - 1])
+            split_cache.width[k - 1] = split_cache.width[k];
+    }
+    split_cache.total_height = x;
+    split_cache.total_depth = d;
+    split_cache.dir = vdir;
+    split_cache.first = 0;
+}
+
+/*tex
+
+    The remainder |p| starts with the material from node |k| in the cache on,
+    optionally preceded by nodes that don't add to the height and glue of width
+    |x|. We get the same box as |vpackage(p, 0, additional, l, vdir)|.
+
+*/
+
+static halfword split_cache_package(halfword p, int k, scaled x, scaled l)
+{
+    halfword r = vpackage(null, 0, additional, l, split_cache.dir);
+    scaled d = split_cache.total_depth;
+    x += split_cache.total_height - split_cache.height[k] - split_cache.depth[k];
+    if (d > l) {
+        x += d - l;
+        d = l;
+    }
+    list_ptr(r) = p;
+    width(r) = split_cache.width[k];
+    height(r) = x;
+    depth(r) = d;
+    split_cache_box = r;
+    split_cache.head = p;
+    split_cache.first = k;
+    split_cache.calls = lua_call_count();
+    return r;
+}
+
 halfword vsplit(halfword n, scaled h, int m)
 {
     /*tex the box to be split */
@@ -1912,6 +2083,9 @@ halfword vsplit(halfword n, scaled h, int m)
     halfword q;
     /*tex for traversing marks lists */
     halfword i;
+    /*tex the position in the split cache */
+    int k = -1;
+    int cached;
     v = box(n);
     vdir = box_dir(v);
     flush_node_list(split_disc);
@@ -1934,6 +2108,8 @@ halfword vsplit(halfword n, scaled h, int m)
         return null;
     }
     q = vert_break(list_ptr(v), h, split_max_depth_par);
+    cached = (v == split_cache_box && list_ptr(v) == split_cache.head && vdir == split_cache.dir
+        && split_cache.calls == lua_call_count() && callback_defined(vpack_filter_callback) <= 0);
     /*tex
 
         Look at all the marks in nodes before the break, and set the final link
@@ -1947,6 +2123,15 @@ halfword vsplit(halfword n, scaled h, int m)
         list_ptr(v) = null;
     } else {
         while (1) {
+            if (cached) {
+                /*tex Keep track of where we are in the split cache. */
+                if (k >= 0) {
+                    if (++k >= split_cache.count || split_cache.nodes[k] != p)
+                        cached = 0;
+                } else if (p == split_cache.nodes[split_cache.first]) {
+                    k = split_cache.first;
+                }
+            }
             if (type(p) == mark_node) {
                 if (split_first_mark(mark_class(p)) == null) {
                     set_split_first_mark(mark_class(p), mark_ptr(p));
@@ -1966,6 +2151,11 @@ halfword vsplit(halfword n, scaled h, int m)
             p = vlink(p);
         }
     }
+    if (cached && q != null) {
+        k = (k >= 0 ? k + 1 : split_cache.first);
+        if (k >= split_cache.count || split_cache.nodes[k] != q)
+            cached = 0;
+    }
     q = prune_page_top(q, saving_vdiscards_par > 0);
     p = list_ptr(v);
     list_ptr(v) = null;
@@ -1973,8 +2163,33 @@ halfword vsplit(halfword n, scaled h, int m)
     if (q == null) {
         /*tex The |eq_level| of the box stays the same. */
         box(n) = null;
-    } else {
+    } else if (cached) {
+        /*tex
+
+            The pruned remainder has some glue in front of the first box or rule
+            and that box or rule is still in the cache.
+
+        */
+        halfword g = null;
+        halfword b = q;
+        while (b != null && type(b) != hlist_node && type(b) != vlist_node && type(b) != rule_node) {
+            g = b;
+            b = vlink(b);
+        }
+        while (b != null && k < split_cache.count && split_cache.nodes[k] != b) {
+            k++;
+        }
+        if (b != null && g != null && type(g) == glue_node && k < split_cache.count) {
+            box(n) = split_cache_package(q, k, width(g), max_depth_par);
+        } else {
+            build_split_cache(q, vdir);
+            box(n) = split_cache_package(q, 0, 0, max_depth_par);
+        }
+    } else if (callback_defined(vpack_filter_callback) > 0) {
         box(n) = filtered_vpackage(q, 0, additional, max_depth_par, split_keep_group, vdir, 0, 0);
+    } else {
+        build_split_cache(q, vdir);
+        box(n) = split_cache_package(q, 0, 0, max_depth_par);
     }
     if (m == exactly) {
         return filtered_vpackage(p, h, exactly, split_max_depth_par, split_off_group, vdir, 0, 0);
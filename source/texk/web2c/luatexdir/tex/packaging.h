@@ -88,6 +88,7 @@ extern scaled best_height_plus_depth;   /* height of the best box, without stret
 
 extern halfword vert_break(halfword p, scaled h, scaled d);
 extern halfword vsplit(halfword n, scaled h, int m); /* extracts a page of height |h| from box |n| */
+extern halfword split_cache_box;        /* the last remainder made by |vsplit| */
 
 #  define box_code      0 /* |chr_code| for `\.{\\box}' */
 #  define copy_code     1 /* |chr_code| for `\.{\\copy}' */
@@ -24,9 +24,6 @@ with LuaTeX; if not, see <http://www.gnu.org/licenses/>.
 #include "ptexlib.h"
 #include "lua/luatex-api.h"
 
-#define wlog(A)  fputc(A,log_file)
-#define wterm(A) fputc(A,term_out)
-
 int new_string_line = 0;
 int escape_controls = 1;
 
@@ -365,12 +362,59 @@ void print(int s)
     lprint(&str_lstring(s));
 }
 
+/*tex
+
+    Strings mostly consist of plain \ASCII\ characters. When we print to the
+    terminal and|/|or log we can write a run of those in one go, as long as it
+    fits on the current line(s); otherwise we fall back on |print_char| which
+    takes care of wrapping and escaping. We return the number of bytes that got
+    written.
+
+*/
+
+#define is_plain_char(A) \
+    ((A >= 0x20) && (A < 0x7F) && (A != new_line_char_par))
+
+static int print_run(const unsigned char *j, const unsigned char *l)
+{
+    int n = 0;
+    int room = max_print_line;
+    if (selector != log_only && term_offset + room > max_print_line)
+        room = max_print_line - term_offset;
+    if (selector != term_only && file_offset + room > max_print_line)
+        room = max_print_line - file_offset;
+    /*tex We leave the last position of a line to |print_char|. */
+    room = room - 1;
+    while (n < room && j + n < l && is_plain_char(j[n]))
+        n++;
+    if (n > 1) {
+        if (selector != log_only) {
+            fwrite(j, 1, (size_t) n, term_out);
+            term_offset += n;
+        }
+        if (selector != term_only) {
+            fwrite(j, 1, (size_t) n, log_file);
+            file_offset += n;
+        }
+        tally += n;
+        return n;
+    }
+    return 0;
+}
+
 void lprint (lstring *ss) {
     /*tex current character code position */
     unsigned char *j, *l;
     j = ss->s;
     l = j + ss->l;
     while (j < l) {
+        if (selector >= term_only && selector <= term_and_log && *j < 0x7F) {
+            int n = print_run(j, l);
+            if (n > 0) {
+                j = j + n;
+                continue;
+            }
+        }
         /*tex I don't bother checking the last two bytes explicitly */
         /* 0x110000 in utf=8: 0xF4 0x90 0x80 0x80 */
         if ((j < l - 4) && (*j == 0xF4) && (*(j + 1) == 0x90)) {
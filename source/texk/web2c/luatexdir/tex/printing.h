@@ -59,10 +59,26 @@ extern boolean inhibit_par_tokens;
     for terminal output, and it is possible to adhere to those conventions
     by changing |wterm|, |wterm_ln|, and |wterm_cr| in this section.
     @^system dependencies@>
+
+    Printing is done from the main thread only, so we can use the variants
+    that don't lock the stream for every character. The characters then end
+    up in the buffer of the stream which is written in bulk.
 */
 
-#  define wterm_cr()   fprintf(term_out,"\n")
-#  define wlog_cr()    fprintf(log_file,"\n")
+#  ifdef _WIN32
+#    define wterm(A)   fputc(A,term_out)
+#    define wlog(A)    fputc(A,log_file)
+#  else
+#    define wterm(A)   putc_unlocked(A,term_out)
+#    define wlog(A)    putc_unlocked(A,log_file)
+#  endif
+
+#  define wterm_cr()   wterm('\n')
+#  define wlog_cr()    wlog('\n')
+
+/*tex The transcript gets a larger buffer than the default one of the stream. */
+
+#  define log_buffer_size 65536
 
 extern void print_ln(void);
 extern void print_char(int s);
@@ -1827,6 +1827,7 @@ void set_font_dimen(void)
     scan_optional_equals();
     scan_normal_dimen();
     set_font_param(f, n, cur_val);
+    font_generation++;
 }
 
 void get_font_dimen(void)
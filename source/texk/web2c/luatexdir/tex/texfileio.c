@@ -23,6 +23,10 @@ with LuaTeX; if not, see <http://www.gnu.org/licenses/>.
 
 #include <string.h>
 #include <kpathsea/absolute.h>
+#ifndef _WIN32
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#endif
 
 /*tex
 
@@ -278,6 +282,132 @@ boolean luatex_open_output(FILE ** f_ptr, const char *fn, const_string fopen_mod
     return *f_ptr != NULL;
 }
 
+/*tex
+
+    When |mapped_input| is set (in \.{texmf.cnf} or |texconfig|) regular input
+    files are mapped into memory as a whole when they are opened. Lines are then
+    located with |memchr|, which the \CLANG\ library implements with wide
+    (vector) compares, and copied into |buffer| in one go, instead of being read
+    character by character with |getc|. This matters for huge generated files.
+    Pipes, terminals and files that can't be mapped are read as usual, as are
+    files that are handled by the reader callbacks.
+
+    The mapping is associated with the |FILE| that \TEX\ keeps for the input
+    level or \.{\read} stream, so the rest of the machinery doesn't see any
+    difference.
+
+*/
+
+int mapped_input = 0;
+
+typedef struct mapped_file {
+    FILE *f;
+    unsigned char *data;
+    size_t size;
+    size_t pos;
+    struct mapped_file *next;
+} mapped_file;
+
+static mapped_file *mapped_files = NULL;
+
+static void map_input_file(FILE *f)
+{
+#ifndef _WIN32
+    struct stat st;
+    long offset;
+    void *data;
+    mapped_file *m;
+    if (f == NULL || fstat(fileno(f), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+        return;
+    offset = ftell(f);
+    if (offset < 0 || (off_t) offset > st.st_size)
+        return;
+    data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (data == MAP_FAILED)
+        return;
+    m = xmalloc(sizeof(mapped_file));
+    m->f = f;
+    m->data = (unsigned char *) data;
+    m->size = (size_t) st.st_size;
+    m->pos = (size_t) offset;
+    m->next = mapped_files;
+    mapped_files = m;
+#else
+    (void) f;
+#endif
+}
+
+static mapped_file *find_mapped_file(FILE *f)
+{
+    mapped_file *m = mapped_files;
+    while (m != NULL && m->f != f)
+        m = m->next;
+    return m;
+}
+
+static void unmap_input_file(FILE *f)
+{
+#ifndef _WIN32
+    mapped_file **p = &mapped_files;
+    while (*p != NULL) {
+        mapped_file *m = *p;
+        if (m->f == f) {
+            *p = m->next;
+            munmap((void *) m->data, m->size);
+            free(m);
+            return;
+        }
+        p = &(m->next);
+    }
+#else
+    (void) f;
+#endif
+}
+
+/*tex
+
+    This is the mapped counterpart of |input_line|: a line ends at a |\n|, a
+    |\r| or a |\r\n| pair, trailing spaces are removed and we return |false|
+    at the end of the file.
+
+*/
+
+static boolean mapped_input_line(mapped_file *m)
+{
+    unsigned char *s = m->data + m->pos;
+    unsigned char *e;
+    size_t n = m->size - m->pos;
+    size_t l;
+    last = first;
+    if (n == 0)
+        return false;
+    e = memchr(s, '\n', n);
+    l = (e == NULL ? n : (size_t) (e - s));
+    e = memchr(s, '\r', l);
+    if (e != NULL)
+        l = (size_t) (e - s);
+    if (l >= (size_t) (buf_size - first)) {
+        fprintf(stderr, "! Unable to read an entire line---bufsize=%u.\n", (unsigned) buf_size);
+        fputs("Please increase buf_size in texmf.cnf.\n", stderr);
+        uexit(1);
+    }
+    memcpy(buffer + first, s, l);
+    last = first + (int) l;
+    buffer[last] = ' ';
+    if (last >= max_buf_stack)
+        max_buf_stack = last;
+    m->pos += l;
+    if (m->pos < m->size) {
+        if (m->data[m->pos] == '\r' && m->pos + 1 < m->size && m->data[m->pos + 1] == '\n')
+            m->pos += 2;
+        else
+            m->pos += 1;
+    }
+    while (last > first && buffer[last - 1] == ' ')
+        --last;
+    return true;
+}
+
 boolean lua_a_open_in(alpha_file * f, char *fn, int n)
 {
     int k;
@@ -313,6 +443,8 @@ boolean lua_a_open_in(alpha_file * f, char *fn, int n)
         /*tex no read callback */
         if (openinnameok(fn)) {
             ret = open_in_or_pipe(f, fnam, kpse_tex_format, FOPEN_RBIN_MODE, (n == 0 ? true : false));
+            if (ret && mapped_input > 0 && *fn != '|')
+                map_input_file(*f);
         } else {
             /*tex open failed */
             file_ok = false;
@@ -399,6 +531,8 @@ void lua_a_close_in(alpha_file f, int n)
         else
             read_file_callback_id[n] = 0;
     } else {
+        if (mapped_files != NULL)
+            unmap_input_file(f);
         close_file_or_pipe(f);
     }
 }
@@ -502,7 +636,11 @@ boolean lua_input_ln(alpha_file f, int n, boolean bypass_eoln)
             lua_result = false;
         }
     } else {
-        lua_result = input_ln(f, bypass_eoln);
+        mapped_file *m = (mapped_files != NULL ? find_mapped_file(f) : NULL);
+        if (m != NULL)
+            lua_result = mapped_input_line(m);
+        else
+            lua_result = input_ln(f, bypass_eoln);
     }
     if (lua_result == true) {
         /*tex Fix up the input buffer using callbacks */
@@ -911,6 +1049,7 @@ void open_log_file(void)
         selector = term_only;
         fn = prompt_file_name("transcript file name", ".log");
     }
+    setvbuf(log_file, NULL, _IOFBF, log_buffer_size);
     texmf_log_name = (unsigned char *) xstrdup(fn);
     selector = log_only;
     log_opened_global = true;
@@ -22,6 +22,7 @@
 #  define TEXFILEIO_H
 
 extern int *input_file_callback_id;
+extern int mapped_input;
 extern int read_file_callback_id[17];
 
 extern char *luatex_find_read_file(const char *s, int n, int callback_index);
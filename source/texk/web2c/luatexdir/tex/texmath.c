@@ -178,6 +178,15 @@ void flush_math(void)
 
 static sa_tree math_fam_head = NULL;
 
+/*tex
+
+    The generation changes whenever a family font or math parameter is assigned
+    or restored, so that cached math results can be invalidated.
+
+*/
+
+int math_data_generation = 0;
+
 int fam_fnt(int fam_id, int size_id)
 {
     int n = fam_id + (256 * size_id);
@@ -190,6 +199,7 @@ void def_fam_fnt(int fam_id, int size_id, int f, int lvl)
     sa_tree_item sa_value = { 0 };
     sa_value.int_value = f;
     set_sa_item(math_fam_head, n, sa_value, lvl);
+    math_data_generation++;
     fixup_math_parameters(fam_id, size_id, f, lvl);
     if (tracing_assigns_par > 1) {
         begin_diagnostic();
@@ -215,6 +225,7 @@ static void unsave_math_fam_data(int gl)
         st = math_fam_head->stack[math_fam_head->stack_ptr];
         if (st.level > 0) {
             rawset_sa_item(math_fam_head, st.code, st.value);
+            math_data_generation++;
             /*tex Now do a trace message, if requested. */
             if (tracing_restores_par > 1) {
                 int size_id = st.code / 256;
@@ -274,6 +285,7 @@ void def_math_param(int param_id, int style_id, scaled value, int lvl)
     }
     sa_value.int_value = (int) value;
     set_sa_item(math_param_head, n, sa_value, lvl);
+    math_data_generation++;
     if (tracing_assigns_par > 1) {
         begin_diagnostic();
         tprint("{assigning");
@@ -342,6 +354,7 @@ static void unsave_math_param_data(int gl)
                 }
             }
             rawset_sa_item(math_param_head, st.code, st.value);
+            math_data_generation++;
             /*tex Do a trace message, if requested. */
             if (tracing_restores_par > 1) {
                 begin_diagnostic();
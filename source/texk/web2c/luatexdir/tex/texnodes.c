@@ -38,6 +38,10 @@ memory_word *volatile varmem = NULL;
 
 char *varmem_sizes = NULL;
 
+/*tex Incremented whenever |varmem| can have been moved by a reallocation. */
+
+int varmem_generation = 0;
+
 halfword var_mem_max = 0;
 halfword rover = 0;
 
@@ -1428,6 +1432,66 @@ int lua_properties_use_metatable = 0 ;
     } \
 } while(0)
 
+/*tex
+
+    Next to the properties table there is an opt|-|in store of slots. A node
+    keeps the index of its slot in an array parallel to node memory, that is only
+    allocated when the first slot is set with |setpropertyslot|. The values live
+    in a table that is used as an array, so there is no hashing involved and
+    nodes without a slot are freed and copied without touching \LUA. Slots are
+    released and copied along with the node, also when properties are disabled.
+
+*/
+
+int *varmem_property_slots = NULL;
+
+void allocate_property_slots(void)
+{
+    if (varmem_property_slots == NULL) {
+        varmem_property_slots = xcalloc((unsigned) var_mem_max, sizeof(int));
+    }
+}
+
+#define has_property_slot(n) \
+    (varmem_property_slots != NULL && varmem_property_slots[n] != 0)
+
+#define lua_property_slot_reset(target) do { \
+    if (has_property_slot(target)) { \
+        lua_get_metatablelua_l(Luas,node_properties_slots); \
+        luaL_unref(Luas,-1,varmem_property_slots[target]); \
+        lua_pop(Luas,1); \
+        varmem_property_slots[target] = 0; \
+    } \
+} while(0)
+
+/*tex A slot is copied the same way as a property: shallow and maybe with a metatable. */
+
+static void lua_property_slot_copy(halfword target, halfword source)
+{
+    lua_get_metatablelua_l(Luas,node_properties_slots);
+    lua_rawgeti(Luas,-1,varmem_property_slots[source]);
+    if (lua_type(Luas,-1)==LUA_TTABLE) {
+        if (lua_properties_use_metatable) {
+            lua_newtable(Luas);
+            lua_insert(Luas,-2);
+            lua_push_string_by_name(Luas,__index);
+            lua_insert(Luas,-2);
+            lua_rawset(Luas, -3);
+            lua_newtable(Luas);
+            lua_insert(Luas,-2);
+            lua_setmetatable(Luas,-2);
+        }
+        if (varmem_property_slots[target] != 0) {
+            lua_rawseti(Luas,-2,varmem_property_slots[target]);
+        } else {
+            varmem_property_slots[target] = luaL_ref(Luas,-2);
+        }
+    } else {
+        lua_pop(Luas,1);
+    }
+    lua_pop(Luas,1);
+}
+
 /*tex Here end the property handlers. */
 
 int valid_node(halfword p)
@@ -2070,6 +2134,9 @@ halfword copy_node(const halfword p)
         add_node_attr_ref(node_attr(p));
         alink(r) = null;
         lua_properties_copy(r,p);
+        if (has_property_slot(p)) {
+            lua_property_slot_copy(r,p);
+        }
     }
     vlink(r) = null;
     switch (t) {
@@ -2325,6 +2392,8 @@ void flush_node(halfword p)
         case hlist_node:
         case vlist_node:
         case unset_node:
+            if (p == split_cache_box)
+                split_cache_box = null;
             free_sub_list(list_ptr(p));
             break;
         case disc_node:
@@ -2439,9 +2508,11 @@ void flush_node(halfword p)
         case split_up_node:
         case expr_node:
         case attribute_node:
-        case attribute_list_node:
         case temp_node:
             break;
+        case attribute_list_node:
+            unintern_attribute_list(p);
+            break;
         default:
             formatted_error("nodes","flushing weird node type %d", type(p));
             return;
@@ -2449,6 +2520,7 @@ void flush_node(halfword p)
     if (nodetype_has_attributes(type(p))) {
         delete_attribute_ref(node_attr(p));
         lua_properties_reset(p);
+        lua_property_slot_reset(p);
     }
     free_node(p, get_node_size(type(p), subtype(p)));
     return;
@@ -2749,7 +2821,9 @@ void free_node(halfword p, int s)
     var_used -= s;
 }
 
-static void free_node_chain(halfword q, int s)
+/*tex Return a |vlink|ed chain of nodes of size |s| in one go. */
+
+void free_node_chain(halfword q, int s)
 {
     register halfword p = q;
     while (vlink(p) != null) {
@@ -2804,6 +2878,7 @@ void init_node_mem(int t)
     my_prealloc = var_mem_stat_max;
 
     varmem = (memory_word *) realloc((void *) varmem, sizeof(memory_word) * (unsigned) t);
+    varmem_generation++;
     if (varmem == NULL) {
         overflow("node memory size", (unsigned) var_mem_max);
     }
@@ -2813,6 +2888,13 @@ void init_node_mem(int t)
         overflow("node memory size", (unsigned) var_mem_max);
     }
     memset((void *) varmem_sizes, 0, sizeof(char) * (unsigned) t);
+    if (varmem_property_slots != NULL) {
+        varmem_property_slots = (int *) realloc(varmem_property_slots, sizeof(int) * (unsigned) t);
+        if (varmem_property_slots == NULL) {
+            overflow("node memory size", (unsigned) var_mem_max);
+        }
+        memset((void *) varmem_property_slots, 0, sizeof(int) * (unsigned) t);
+    }
     var_mem_max = t;
     rover = var_mem_stat_max + 1;
     vlink(rover) = rover;
@@ -2870,6 +2952,8 @@ void undump_node_mem(void)
     undump_int(rover);
     var_mem_max = (x < 100000 ? 100000 : x);
     varmem = xmallocarray(memory_word, (unsigned) var_mem_max);
+    varmem_generation++;
+    xfree(varmem_property_slots);
     undump_things(varmem[0], x);
     varmem_sizes = xmallocarray(char, (unsigned) var_mem_max);
     memset((void *) varmem_sizes, 0, (unsigned) var_mem_max * sizeof(char));
@@ -2949,6 +3033,7 @@ halfword slow_get_node(int s)
             /*tex If we are still here, it was apparently impossible to get a match. */
             x = (var_mem_max >> 2) + s;
             varmem = (memory_word *) realloc((void *) varmem, sizeof(memory_word) * (unsigned) (var_mem_max + x));
+            varmem_generation++;
             if (varmem == NULL) {
                 overflow("node memory size", (unsigned) var_mem_max);
             }
@@ -2958,6 +3043,13 @@ halfword slow_get_node(int s)
                 overflow("node memory size", (unsigned) var_mem_max);
             }
             memset((void *) (varmem_sizes + var_mem_max), 0, (unsigned) (x) * sizeof(char));
+            if (varmem_property_slots != NULL) {
+                varmem_property_slots = (int *) realloc(varmem_property_slots, sizeof(int) * (unsigned) (var_mem_max + x));
+                if (varmem_property_slots == NULL) {
+                    overflow("node memory size", (unsigned) var_mem_max);
+                }
+                memset((void *) (varmem_property_slots + var_mem_max), 0, (unsigned) (x) * sizeof(int));
+            }
             /*tex Todo: is it perhaps possible to merge the new memory with an existing rover? */
             vlink(var_mem_max) = rover;
             node_size(var_mem_max) = x;
@@ -3074,6 +3166,205 @@ halfword new_span_node(halfword n, int s, scaled w)
 
 /* Now comes some attribute stuff. */
 
+/*tex
+
+    Attribute lists that are built from the current attribute state or changed
+    by |set_attribute| and |unset_attribute| are interned: identical lists are
+    shared, so that a document that toggles a few attributes ends up with a few
+    lists instead of one per node. An interned list gets a record that is found
+    by hashing its content. The record index is stored in the list head, and a
+    record also caches an array of values indexed by attribute id, so that
+    looking up an attribute in such a list is a direct access.
+
+    Interned lists are never changed in place, a list is first taken out of the
+    table and put back afterwards. Lists made in other ways are left alone and
+    looked up the traditional way. The same is true for lists that have been
+    passed to or from \LUA: these are marked as exposed and never interned,
+    because they can be edited at that end, so they keep the sharing that they
+    had before.
+
+*/
+
+#define attribute_list_hash_size 1024
+#define attribute_list_max_records 0xFFFF
+#define attribute_list_max_index 1024
+
+typedef struct {
+    halfword list;
+    unsigned int hash;
+    int next;
+    int max;
+    int *values;
+} attribute_list_record;
+
+static attribute_list_record *attribute_list_records = NULL;
+static int attribute_list_records_size = 0;
+static int attribute_list_records_used = 0;
+static int attribute_list_records_free = 0;
+static int attribute_list_hash[attribute_list_hash_size] = { 0 };
+
+#define attribute_list_exposed -1
+
+/*tex A list is interned when its head points to a record that points back. */
+
+static int interned_attribute_list(halfword b)
+{
+    int k = attr_list_record(b);
+    if (k > 0 && k <= attribute_list_records_used && attribute_list_records[k].list == b) {
+        return k;
+    } else {
+        return 0;
+    }
+}
+
+static unsigned int attribute_list_hash_code(halfword b)
+{
+    unsigned int h = 0;
+    b = vlink(b);
+    while (b != null) {
+        h = h * 31 + (unsigned int) attribute_id(b);
+        h = h * 31 + (unsigned int) attribute_value(b);
+        b = vlink(b);
+    }
+    return h;
+}
+
+static int same_attribute_lists(halfword a, halfword b)
+{
+    a = vlink(a);
+    b = vlink(b);
+    while (a != null && b != null) {
+        if (attribute_id(a) != attribute_id(b) || attribute_value(a) != attribute_value(b)) {
+            return 0;
+        }
+        a = vlink(a);
+        b = vlink(b);
+    }
+    return a == b;
+}
+
+void unintern_attribute_list(halfword b)
+{
+    int k = interned_attribute_list(b);
+    if (k > 0) {
+        attribute_list_record *r = &attribute_list_records[k];
+        int *p = &attribute_list_hash[r->hash % attribute_list_hash_size];
+        while (*p != k) {
+            p = &attribute_list_records[*p].next;
+        }
+        *p = r->next;
+        xfree(r->values);
+        r->list = null;
+        r->next = attribute_list_records_free;
+        attribute_list_records_free = k;
+        attr_list_record(b) = 0;
+    }
+}
+
+/*tex
+
+    We return the interned list that equals |b|. When there is one already, |b|
+    is freed and its references are transferred, otherwise |b| gets a record.
+
+*/
+
+static halfword intern_attribute_list(halfword b)
+{
+    unsigned int h;
+    int k;
+    attribute_list_record *r;
+    if (attr_list_record(b) == attribute_list_exposed) {
+        return b;
+    }
+    h = attribute_list_hash_code(b);
+    k = attribute_list_hash[h % attribute_list_hash_size];
+    while (k > 0) {
+        r = &attribute_list_records[k];
+        if (r->hash == h && same_attribute_lists(r->list, b)) {
+            attr_list_ref(r->list) += attr_list_ref(b);
+            if (b == attr_list_cache) {
+                attr_list_cache = r->list;
+            }
+            free_node_chain(b, attribute_node_size);
+            return r->list;
+        }
+        k = r->next;
+    }
+    if (attribute_list_records_free > 0) {
+        k = attribute_list_records_free;
+        attribute_list_records_free = attribute_list_records[k].next;
+    } else if (attribute_list_records_used < attribute_list_max_records) {
+        k = ++attribute_list_records_used;
+        if (k >= attribute_list_records_size) {
+            attribute_list_records_size += 256;
+            attribute_list_records = xreallocarray(attribute_list_records, attribute_list_record, (unsigned) attribute_list_records_size);
+        }
+    } else {
+        attr_list_record(b) = 0;
+        return b;
+    }
+    r = &attribute_list_records[k];
+    r->list = b;
+    r->hash = h;
+    r->next = attribute_list_hash[h % attribute_list_hash_size];
+    r->max = -1;
+    r->values = NULL;
+    attribute_list_hash[h % attribute_list_hash_size] = k;
+    attr_list_record(b) = k;
+    return b;
+}
+
+/*tex
+
+    The value index is made when it is needed first. Lists that are not sorted
+    or use large ids are not indexed.
+
+*/
+
+static int *attribute_list_values(int k)
+{
+    attribute_list_record *r = &attribute_list_records[k];
+    if (r->values == NULL && r->max == -1) {
+        halfword p = vlink(r->list);
+        int i = -1;
+        while (p != null) {
+            if (attribute_id(p) <= i || attribute_id(p) >= attribute_list_max_index) {
+                r->max = -2;
+                return NULL;
+            }
+            i = attribute_id(p);
+            p = vlink(p);
+        }
+        r->max = i;
+        r->values = xmallocarray(int, (unsigned) (i + 1));
+        for (; i >= 0; i--) {
+            r->values[i] = UNUSED_ATTRIBUTE;
+        }
+        p = vlink(r->list);
+        while (p != null) {
+            r->values[attribute_id(p)] = attribute_value(p);
+            p = vlink(p);
+        }
+    }
+    return r->values;
+}
+
+/*tex
+
+    This is called when a list is handed over to or from \LUA. From then on it
+    can be changed at that end without us knowing, so it leaves the table and
+    stays out of it.
+
+*/
+
+void expose_attribute_list(halfword b)
+{
+    if (b != null && type(b) == attribute_list_node) {
+        unintern_attribute_list(b);
+        attr_list_record(b) = attribute_list_exposed;
+    }
+}
+
 static halfword new_attribute_node(unsigned int i, int v)
 {
     register halfword r = get_node(attribute_node_size);
@@ -3090,6 +3381,7 @@ halfword copy_attribute_list(halfword n)
     halfword q = get_node(attribute_node_size);
     register halfword p = q;
     type(p) = attribute_list_node;
+    attr_list_record(p) = 0;
     attr_list_ref(p) = 0;
     n = vlink(n);
     while (n != null) {
@@ -3109,6 +3401,7 @@ void update_attribute_cache(void)
     register int i;
     attr_list_cache = get_node(attribute_node_size);
     type(attr_list_cache) = attribute_list_node;
+    attr_list_record(attr_list_cache) = 0;
     attr_list_ref(attr_list_cache) = 0;
     p = attr_list_cache;
     for (i = 0; i <= max_used_attr; i++) {
@@ -3122,6 +3415,8 @@ void update_attribute_cache(void)
     if (vlink(attr_list_cache) == null) {
         free_node(attr_list_cache, attribute_node_size);
         attr_list_cache = null;
+    } else {
+        attr_list_cache = intern_attribute_list(attr_list_cache);
     }
     return;
 }
@@ -3180,6 +3475,7 @@ void delete_attribute_ref(halfword b)
             if (attr_list_ref(b) == 0) {
                 if (b == attr_list_cache)
                     attr_list_cache = cache_disabled;
+                unintern_attribute_list(b);
                 free_node_chain(b, attribute_node_size);
             }
             /*tex Maintain sanity. */
@@ -3196,6 +3492,7 @@ void reset_node_properties(halfword b)
 {
     if (b != null) {
         lua_properties_reset(b);
+        lua_property_slot_reset(b);
     }
 }
 
@@ -3209,11 +3506,13 @@ halfword do_set_attribute(halfword p, int i, int val)
         /*tex Add a new head \& node. */
         q = get_node(attribute_node_size);
         type(q) = attribute_list_node;
+        attr_list_record(q) = 0;
         attr_list_ref(q) = 1;
         p = new_attribute_node((unsigned) i, val);
         vlink(q) = p;
         return q;
     }
+    unintern_attribute_list(p);
     q = p;
     if (vlink(p) != null) {
         while (vlink(p) != null) {
@@ -3255,12 +3554,15 @@ void set_attribute(halfword n, int i, int val)
     /*tex If we have no list, we create one and quit. */
     p = node_attr(n);
     if (p == null) {            /* add a new head \& node */
+        halfword r;
         p = get_node(attribute_node_size);
         type(p) = attribute_list_node;
+        attr_list_record(p) = 0;
         attr_list_ref(p) = 1;
-        node_attr(n) = p;
-        p = new_attribute_node((unsigned) i, val);
-        vlink(node_attr(n)) = p;
+        /*tex We need a local because |varmem| can move when the node is made. */
+        r = new_attribute_node((unsigned) i, val);
+        vlink(p) = r;
+        node_attr(n) = intern_attribute_list(p);
         return;
     }
     /*tex We check if we have this attribute already and quit if the value stays the same. */
@@ -3281,6 +3583,7 @@ void set_attribute(halfword n, int i, int val)
             formatted_warning("nodes","node %d has an attribute list that is free already, case 1",(int) n);
             /*tex The still dangling list gets ref count 1. */
             attr_list_ref(p) = 1;
+            unintern_attribute_list(p);
         } else if (attr_list_ref(p) == 1) {
             /*tex This can really happen! */
             if (p == attr_list_cache) {
@@ -3294,6 +3597,9 @@ void set_attribute(halfword n, int i, int val)
                 node_attr(n) = p;
                 /*tex The copied list gets ref count 1. */
                 attr_list_ref(p) = 1;
+            } else {
+                /*tex We are the only user so we can change it in place. */
+                unintern_attribute_list(p);
             }
         } else {
             /*tex The list is used multiple times so we make a copy. */
@@ -3316,6 +3622,7 @@ void set_attribute(halfword n, int i, int val)
             vlink(r) = vlink(p);
             vlink(p) = r;
         }
+        node_attr(n) = intern_attribute_list(node_attr(n));
     } else {
         normal_error("nodes","trying to set an attribute fails, case 2");
     }
@@ -3358,6 +3665,8 @@ int unset_attribute(halfword n, int i, int val)
             }
             attr_list_ref(q) = 1;
             node_attr(n) = q;
+        } else {
+            unintern_attribute_list(p);
         }
         p = vlink(node_attr(n));
         while (j-- > 0)
@@ -3366,6 +3675,7 @@ int unset_attribute(halfword n, int i, int val)
         if (val == UNUSED_ATTRIBUTE || t == val) {
             attribute_value(p) = UNUSED_ATTRIBUTE;
         }
+        node_attr(n) = intern_attribute_list(node_attr(n));
         return t;
     } else {
         normal_error("nodes","trying to unset an attribute fails");
@@ -3373,21 +3683,25 @@ int unset_attribute(halfword n, int i, int val)
     }
 }
 
-int has_attribute(halfword n, int i, int val)
+/*tex Here |p| is an attr list head, the result is |UNUSED_ATTRIBUTE| when not found. */
+
+int attribute_list_value(halfword p, int i)
 {
-    register halfword p;
-    if (!nodetype_has_attributes(type(n)))
-        return UNUSED_ATTRIBUTE;
-    p = node_attr(n);
-    if (p == null || vlink(p) == null)
-        return UNUSED_ATTRIBUTE;
+    int k = interned_attribute_list(p);
+    if (k > 0) {
+        int *values = attribute_list_values(k);
+        if (values != NULL) {
+            if (i < 0 || i > attribute_list_records[k].max) {
+                return UNUSED_ATTRIBUTE;
+            } else {
+                return values[i];
+            }
+        }
+    }
     p = vlink(p);
     while (p != null) {
         if (attribute_id(p) == i) {
-            int ret = attribute_value(p);
-            if (val == UNUSED_ATTRIBUTE || val == ret)
-                return ret;
-            return UNUSED_ATTRIBUTE;
+            return attribute_value(p);
         } else if (attribute_id(p) > i) {
             return UNUSED_ATTRIBUTE;
         }
@@ -3396,6 +3710,21 @@ int has_attribute(halfword n, int i, int val)
     return UNUSED_ATTRIBUTE;
 }
 
+int has_attribute(halfword n, int i, int val)
+{
+    register halfword p;
+    int ret;
+    if (!nodetype_has_attributes(type(n)))
+        return UNUSED_ATTRIBUTE;
+    p = node_attr(n);
+    if (p == null || vlink(p) == null)
+        return UNUSED_ATTRIBUTE;
+    ret = attribute_list_value(p, i);
+    if (val == UNUSED_ATTRIBUTE || val == ret)
+        return ret;
+    return UNUSED_ATTRIBUTE;
+}
+
 void print_short_node_contents(halfword p)
 {
     switch (type(p)) {
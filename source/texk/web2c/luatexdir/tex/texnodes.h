@@ -27,9 +27,21 @@
 
 extern memory_word *volatile varmem;
 extern halfword var_mem_max;
+extern char *varmem_sizes;
+extern int varmem_generation;
+
+/*tex
+
+    The layout of the node fields is visible from \LUA\ (for use with |ffi|) so
+    this number has to be incremented whenever a field moves or is renamed.
+
+*/
+
+#  define node_memory_layout_version 2
 
 extern halfword get_node(int s);
 extern void free_node(halfword p, int s);
+extern void free_node_chain(halfword q, int s);
 extern void init_node_mem(int s);
 extern void dump_node_mem(void);
 extern void undump_node_mem(void);
@@ -70,9 +82,10 @@ extern void undump_node_mem(void);
 #  define attribute_node_size 2
 #  define cache_disabled max_halfword
 
-#  define attr_list_ref(a)   vinfo((a)+1) /* the reference count */
-#  define attribute_id(a)    vinfo((a)+1)
-#  define attribute_value(a) vlink((a)+1)
+#  define attr_list_ref(a)    vinfo((a)+1) /* the reference count */
+#  define attr_list_record(a) vlink((a)+1) /* the interned list record */
+#  define attribute_id(a)     vinfo((a)+1)
+#  define attribute_value(a)  vlink((a)+1)
 
 #  define assign_attribute_ref(n,p) do {     \
         node_attr(n) = p;attr_list_ref(p)++; \
@@ -1017,6 +1030,9 @@ extern halfword current_attribute_list(void);
 extern int unset_attribute(halfword n, int c, int w);
 extern void set_attribute(halfword n, int c, int w);
 extern int has_attribute(halfword n, int c, int w);
+extern int attribute_list_value(halfword p, int i);
+extern void expose_attribute_list(halfword b);
+extern void unintern_attribute_list(halfword b);
 
 extern halfword new_span_node(halfword n, int c, scaled w);
 
@@ -1168,6 +1184,8 @@ extern halfword new_penalty(int m, int s);
 extern int lua_properties_enabled ;
 extern int lua_properties_level ;
 extern int lua_properties_use_metatable ;
+extern int *varmem_property_slots;
+extern void allocate_property_slots(void);
 
 extern halfword make_local_par_node(int mode);
 
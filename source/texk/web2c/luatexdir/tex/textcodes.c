@@ -39,6 +39,31 @@ static sa_tree *catcode_heads = NULL;
 static int catcode_max = 0;
 static unsigned char *catcode_valid = NULL;
 
+/*tex
+
+    Most input is \ASCII, so for each table in use we also keep a flat copy of
+    the codes of the first 128 characters. That way the tokenizer classifies a
+    character with one array access instead of walking the tree. A flat copy is
+    made when it is needed and dropped when the tree changes in ways that we
+    can't follow.
+
+*/
+
+unsigned char **catcode_flat = NULL;
+
+#define drop_flat_cat_codes(h) xfree(catcode_flat[h])
+
+static void make_flat_cat_codes(int h)
+{
+    int k;
+    sa_tree s = catcode_heads[h];
+    unsigned char *f = Mxmalloc_array(unsigned char, 128);
+    for (k = 0; k < 128; k++) {
+        f[k] = (unsigned char) get_sa_item(s, k).int_value;
+    }
+    catcode_flat[h] = f;
+}
+
 void set_cat_code(int h, int n, halfword v, quarterword gl)
 {
     sa_tree_item sa_value = { 0 };
@@ -52,6 +77,8 @@ void set_cat_code(int h, int n, halfword v, quarterword gl)
     }
     sa_value.int_value = (int) v;
     set_sa_item(s, n, sa_value, gl);
+    if (n < 128 && catcode_flat[h] != NULL)
+        catcode_flat[h][n] = (unsigned char) v;
 }
 
 halfword get_cat_code(int h, int n)
@@ -65,6 +92,11 @@ halfword get_cat_code(int h, int n)
         s = new_sa_tree(CATCODESTACK, 1, sa_value);
         catcode_heads[h] = s;
     }
+    if (n >= 0 && n < 128) {
+        if (catcode_flat[h] == NULL)
+            make_flat_cat_codes(h);
+        return (halfword) catcode_flat[h][n];
+    }
     return (halfword) get_sa_item(s, n).int_value;
 }
 
@@ -74,8 +106,12 @@ void unsave_cat_codes(int h, quarterword gl)
     if (h > catcode_max)
         catcode_max = h;
     for (k = 0; k <= catcode_max; k++) {
-        if (catcode_heads[k] != NULL)
+        if (catcode_heads[k] != NULL) {
+            int p = catcode_heads[k]->stack_ptr;
             restore_sa_stack(catcode_heads[k], gl);
+            if (catcode_heads[k]->stack_ptr != p)
+                drop_flat_cat_codes(k);
+        }
     }
 }
 
@@ -85,6 +121,7 @@ static void initializecatcodes(void)
     catcode_max = 0;
     catcode_heads = Mxmalloc_array(sa_tree, (CATCODE_MAX + 1));
     catcode_valid = Mxmalloc_array(unsigned char, (CATCODE_MAX + 1));
+    catcode_flat = Mxcalloc_array(unsigned char *, (CATCODE_MAX + 1));
     memset(catcode_heads, 0, sizeof(sa_tree) * (CATCODE_MAX + 1));
     memset(catcode_valid, 0, sizeof(unsigned char) * (CATCODE_MAX + 1));
     catcode_valid[0] = 1;
@@ -114,6 +151,13 @@ static void dumpcatcodes(void)
 static void undumpcatcodes(void)
 {
     int total, k, x;
+    if (catcode_flat == NULL) {
+        catcode_flat = Mxcalloc_array(unsigned char *, (CATCODE_MAX + 1));
+    } else {
+        for (k = 0; k <= CATCODE_MAX; k++) {
+            drop_flat_cat_codes(k);
+        }
+    }
     xfree(catcode_heads);
     xfree(catcode_valid);
     catcode_heads = Mxmalloc_array(sa_tree, (CATCODE_MAX + 1));
@@ -145,6 +189,7 @@ void copy_cat_codes(int from, int to)
     if (to > catcode_max)
         catcode_max = to;
     destroy_sa_tree(catcode_heads[to]);
+    drop_flat_cat_codes(to);
     catcode_heads[to] = copy_sa_tree(catcode_heads[from]);
     catcode_valid[to] = 1;
 }
@@ -155,6 +200,7 @@ void initex_cat_codes(int h)
     if (h > catcode_max)
         catcode_max = h;
     destroy_sa_tree(catcode_heads[h]);
+    drop_flat_cat_codes(h);
     catcode_heads[h] = NULL;
     set_cat_code(h, '\r', car_ret_cmd, 1);
     set_cat_code(h, ' ', spacer_cmd, 1);
@@ -177,9 +223,11 @@ static void freecatcodes(void)
         if (catcode_valid[k]) {
             destroy_sa_tree(catcode_heads[k]);
         }
+        drop_flat_cat_codes(k);
     }
     xfree(catcode_heads);
     xfree(catcode_valid);
+    xfree(catcode_flat);
 }
 
 /*tex
@@ -511,20 +559,26 @@ void free_text_codes(void)
     freehjcodes();
 }
 
+/*tex Catcode tables and hjcode tables can share blocks, also in the format. */
+
 void dump_text_codes(void)
 {
+    reset_sa_shared_blocks();
     dumpcatcodes();
     dumplccodes();
     dumpuccodes();
     dumpsfcodes();
     dumphjcodes();
+    reset_sa_shared_blocks();
 }
 
 void undump_text_codes(void)
 {
+    reset_sa_shared_blocks();
     undumpcatcodes();
     undumplccodes();
     undumpuccodes();
     undumpsfcodes();
     undumphjcodes();
+    reset_sa_shared_blocks();
 }
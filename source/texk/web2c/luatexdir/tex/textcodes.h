@@ -22,8 +22,15 @@
 #ifndef TEXTCODES_H
 #  define TEXTCODES_H
 
+extern unsigned char **catcode_flat;
+
 void set_cat_code(int h, int n, halfword v, quarterword gl);
 halfword get_cat_code(int h, int n);
+
+/*tex A shortcut for the \ASCII\ range that avoids the call when possible. */
+
+#  define get_cat_code_fast(h,n) \
+    (((n) >= 0 && (n) < 128 && catcode_flat[h] != NULL) ? (halfword) catcode_flat[h][n] : get_cat_code(h,n))
 int valid_catcode_table(int h);
 void unsave_cat_codes(int h, quarterword gl);
 void copy_cat_codes(int from, int to);
@@ -23,9 +23,9 @@ LuaTeX; if not, see <http://www.gnu.org/licenses/>.
 
 #define do_get_cat_code(a,b) do { \
     if (line_catcode_table==DEFAULT_CAT_TABLE) \
-      a=get_cat_code(cat_code_table_par,b); \
+      a=get_cat_code_fast(cat_code_table_par,b); \
     else if (line_catcode_table>-0xFF) \
-      a=get_cat_code(line_catcode_table,b); \
+      a=get_cat_code_fast(line_catcode_table,b); \
     else \
       a= - line_catcode_table - 0xFF ; \
   } while (0)
@@ -149,6 +149,52 @@ void initialize_tokens(void)
     Single-word node allocation:
 */
 
+/*tex
+
+    Lists that are flushed as a whole are not walked immediately. Instead we
+    push their heads on a stack of pending lists and take nodes from those
+    lists when |avail| runs dry. As a list has to be walked anyway when its
+    nodes are reused, this saves a complete pass over every flushed list, which
+    adds up with big macros and lots of \.{\edef}s. The nodes in pending lists
+    are still counted in |dyn_used| until they are reused, so when exact numbers
+    are needed we first call |flush_pending_lists|, which puts all pending nodes
+    on the |avail| list the traditional way.
+
+*/
+
+static halfword *pending_lists = NULL;
+static int pending_lists_ptr = 0;
+static int pending_lists_size = 0;
+
+/*tex The pending list that we're currently taking nodes from. */
+
+static halfword pending_list = null;
+
+static void release_list(halfword p)
+{
+    halfword q, r;
+    r = p;
+    do {
+        q = r;
+        r = token_link(r);
+        decr(dyn_used);
+    } while (r != null);
+    /*tex Now |q| is the last node on the list. */
+    token_link(q) = avail;
+    avail = p;
+}
+
+void flush_pending_lists(void)
+{
+    if (pending_list != null) {
+        release_list(pending_list);
+        pending_list = null;
+    }
+    while (pending_lists_ptr > 0) {
+        release_list(pending_lists[--pending_lists_ptr]);
+    }
+}
+
 halfword get_avail(void)
 {
     /*tex The new node being got: */
@@ -159,6 +205,14 @@ halfword get_avail(void)
     if (p != null) {
         /*tex Pop it off. */
         avail = token_link(avail);
+    } else if (pending_list != null || pending_lists_ptr > 0) {
+        /*tex Take one from a pending list, it is already counted as used. */
+        if (pending_list == null)
+            pending_list = pending_lists[--pending_lists_ptr];
+        p = (unsigned) pending_list;
+        pending_list = token_link(pending_list);
+        token_link(p) = null;
+        return (halfword) p;
     } else if (fix_mem_end < fix_mem_max) {
         /*tex Go into virgin territory. */
         incr(fix_mem_end);
@@ -189,7 +243,7 @@ halfword get_avail(void)
 /*tex
 
     The procedure |flush_list(p)| frees an entire linked list of one-word nodes
-    that starts at position |p|.
+    that starts at position |p|. The list becomes a pending one, see above.
 
     This makes list of single-word nodes available:
 
@@ -197,17 +251,12 @@ halfword get_avail(void)
 
 void flush_list(halfword p)
 {
-    halfword q, r;
     if (p != null) {
-        r = p;
-        do {
-            q = r;
-            r = token_link(r);
-            decr(dyn_used);
-        } while (r != null);
-        /*tex Now |q| is the last node on the list. */
-        token_link(q) = avail;
-        avail = p;
+        if (pending_lists_ptr == pending_lists_size) {
+            pending_lists_size += 256;
+            pending_lists = xrealloc(pending_lists, (unsigned) pending_lists_size * sizeof(halfword));
+        }
+        pending_lists[pending_lists_ptr++] = p;
     }
 }
 
@@ -516,6 +565,45 @@ int get_char_cat_code(int curchr)
     return a;
 }
 
+/*tex
+
+    In running text most characters are letters and other characters that come
+    from a file and end up as glyphs. When the main control loop has typeset
+    such a character it can ask for the length of the run of similar ones that
+    follow on the current line, and handle them in one go without passing each
+    one through |get_x_token|. We only consider \ASCII\ here, so that a byte
+    is a character, and in the middle of a line we get exactly the same result
+    as with |get_next|: a letter or other character, no state change and no
+    expansion. The characters are not consumed here.
+
+*/
+
+int plain_char_run(void)
+{
+    int k, n = 0;
+    unsigned char *f = NULL;
+    if (istate != mid_line || iloc > ilimit || detokenized_line()) {
+        return 0;
+    } else if (line_catcode_table == DEFAULT_CAT_TABLE) {
+        get_cat_code(cat_code_table_par, 0);
+        f = catcode_flat[cat_code_table_par];
+    } else if (line_catcode_table > -0xFF) {
+        get_cat_code(line_catcode_table, 0);
+        f = catcode_flat[line_catcode_table];
+    } else {
+        k = - line_catcode_table - 0xFF;
+        if (k != letter_cmd && k != other_char_cmd)
+            return 0;
+    }
+    for (k = iloc; k <= ilimit; k++) {
+        int c = buffer[k];
+        if (c >= 128 || (f != NULL && f[c] != letter_cmd && f[c] != other_char_cmd))
+            break;
+        n++;
+    }
+    return n;
+}
+
 static void invalid_character_error(void)
 {
     const char *hlp[] = {
@@ -1854,9 +1942,19 @@ static next_line_retval next_line(void)
                                 istate = new_line;
                             break;
                         case 2:
-                            /*tex token */
-                            cur_tok = n;
-                            back_input();
+                            /*tex
+                                A token or a list of tokens. A single token can
+                                be a brace, so it goes through |back_input| that
+                                compensates |align_state|. Longer lists have no
+                                braces and alignment tokens.
+                            */
+                            if (token_link(n) == null) {
+                                cur_tok = token_info(n);
+                                free_avail(n);
+                                back_input();
+                            } else {
+                                back_list(n);
+                            }
                             /*tex Needs checking. */
                             return next_line_restart;
                             break;
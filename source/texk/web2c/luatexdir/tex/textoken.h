@@ -101,6 +101,7 @@ the places that would otherwise account for the most calls of |get_avail|.
 extern void print_meaning(void);
 
 extern void flush_list(halfword p);
+extern void flush_pending_lists(void);
 extern void show_token_list(int p, int q, int l);
 extern void token_show(halfword p);
 
@@ -131,6 +132,7 @@ extern halfword active_to_cs(int, int);
 extern void get_token_lua(void);
 halfword string_to_toks(const char *);
 extern int get_char_cat_code(int);
+extern int plain_char_run(void);
 
 /*
 |no_expand_flag| is a special character value that is inserted by
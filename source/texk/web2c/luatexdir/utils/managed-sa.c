@@ -31,6 +31,45 @@ LuaTeX; if not, see <http://www.gnu.org/licenses/>.
 
 #include "ptexlib.h"
 
+/*tex
+
+    A tree can be copied, which happens for instance when we save a catcode
+    table. As most blocks of |LOWPART| items are never changed afterwards,
+    copies share blocks. Each block has an extra item after the last value that
+    keeps the number of trees that use it, and a block that is shared is only
+    duplicated when a tree changes it. Copying a tree is then a matter of
+    copying the two upper levels of pointers.
+
+*/
+
+#define sa_block_refs(b) ((b)[LOWPART].int_value)
+
+static sa_tree_item *new_sa_block(void)
+{
+    sa_tree_item *b = Mxmalloc_array(sa_tree_item, LOWPART + 1);
+    sa_block_refs(b) = 1;
+    return b;
+}
+
+static void free_sa_block(sa_tree_item *b)
+{
+    if (b != NULL && --sa_block_refs(b) == 0)
+        free(b);
+}
+
+static sa_tree_item *own_sa_block(sa_tree head, int h, int m)
+{
+    sa_tree_item *b = head->tree[h][m];
+    if (sa_block_refs(b) > 1) {
+        sa_tree_item *c = new_sa_block();
+        memcpy(c, b, sizeof(sa_tree_item) * LOWPART);
+        sa_block_refs(b)--;
+        head->tree[h][m] = c;
+        return c;
+    }
+    return b;
+}
+
 static void store_sa_stack(sa_tree a, int n, sa_tree_item v, int gl)
 {
     sa_stack_item st;
@@ -87,10 +126,12 @@ void set_sa_item(sa_tree head, int n, sa_tree_item v, int gl)
     }
     if (head->tree[h][m] == NULL) {
         int i;
-        head->tree[h][m] = (sa_tree_item *) Mxmalloc_array(sa_tree_item, LOWPART);
+        head->tree[h][m] = new_sa_block();
         for (i = 0; i < LOWPART; i++) {
             head->tree[h][m][i] = head->dflt;
         }
+    } else {
+        own_sa_block(head, h, m);
     }
     if (gl <= 1) {
         skip_in_stack(head, n);
@@ -102,7 +143,7 @@ void set_sa_item(sa_tree head, int n, sa_tree_item v, int gl)
 
 void rawset_sa_item(sa_tree head, int n, sa_tree_item v)
 {
-    head->tree[HIGHPART_PART(n)][MIDPART_PART(n)][LOWPART_PART(n)] = v;
+    own_sa_block(head, HIGHPART_PART(n), MIDPART_PART(n))[LOWPART_PART(n)] = v;
 }
 
 void clear_sa_stack(sa_tree a)
@@ -121,7 +162,7 @@ void destroy_sa_tree(sa_tree a)
         for (h = 0; h < HIGHPART; h++) {
             if (a->tree[h] != NULL) {
                 for (m = 0; m < MIDPART; m++) {
-                    xfree(a->tree[h][m]);
+                    free_sa_block(a->tree[h][m]);
                 }
                 xfree(a->tree[h]);
             }
@@ -150,9 +191,8 @@ sa_tree copy_sa_tree(sa_tree b)
                 a->tree[h] = (sa_tree_item **) Mxcalloc_array(void *, MIDPART);
                 for (m = 0; m < MIDPART; m++) {
                     if (b->tree[h][m] != NULL) {
-                        a->tree[h][m] = Mxmalloc_array(sa_tree_item, LOWPART);
-                        memcpy(a->tree[h][m], b->tree[h][m],
-                               sizeof(sa_tree_item) * LOWPART);
+                        a->tree[h][m] = b->tree[h][m];
+                        sa_block_refs(a->tree[h][m])++;
                     }
                 }
             }
@@ -202,6 +242,46 @@ void restore_sa_stack(sa_tree head, int gl)
     }
 }
 
+/*tex
+
+    Shared blocks are also shared in the format: the first time such a block is
+    dumped it gets registered and later occurrences only refer to it by number,
+    so the block is dumped once and shared again after undumping. The markers
+    are 1 for a normal block, 2 for the first occurrence of a shared block and 3
+    for a reference. The registry is reset before and after a batch of trees.
+
+*/
+
+static sa_tree_item **sa_shared_blocks = NULL;
+static int sa_shared_count = 0;
+static int sa_shared_size = 0;
+
+void reset_sa_shared_blocks(void)
+{
+    xfree(sa_shared_blocks);
+    sa_shared_count = 0;
+    sa_shared_size = 0;
+}
+
+static void register_sa_block(sa_tree_item *b)
+{
+    if (sa_shared_count == sa_shared_size) {
+        sa_shared_size += 64;
+        sa_shared_blocks = Mxrealloc_array(sa_shared_blocks, sa_tree_item *, sa_shared_size);
+    }
+    sa_shared_blocks[sa_shared_count++] = b;
+}
+
+static int registered_sa_block(sa_tree_item *b)
+{
+    int i;
+    for (i = 0; i < sa_shared_count; i++) {
+        if (sa_shared_blocks[i] == b)
+            return i;
+    }
+    return -1;
+}
+
 void dump_sa_tree(sa_tree a, const char * name)
 {
     boolean f;
@@ -221,7 +301,19 @@ void dump_sa_tree(sa_tree a, const char * name)
                 dump_qqqq(f);
                 for (m = 0; m < MIDPART; m++) {
                     if (a->tree[h][m] != NULL) {
-                        f = 1;
+                        if (sa_block_refs(a->tree[h][m]) > 1) {
+                            x = registered_sa_block(a->tree[h][m]);
+                            if (x >= 0) {
+                                f = 3;
+                                dump_qqqq(f);
+                                dump_int(x);
+                                continue;
+                            }
+                            register_sa_block(a->tree[h][m]);
+                            f = 2;
+                        } else {
+                            f = 1;
+                        }
                         dump_qqqq(f);
                         for (l = 0; l < LOWPART; l++) {
                             if (n == 2) {
@@ -277,8 +369,18 @@ sa_tree undump_sa_tree(const char * name)
             a->tree[h] = (sa_tree_item **) Mxcalloc_array(void *, MIDPART);
             for (m = 0; m < MIDPART; m++) {
                 undump_qqqq(f);
-                if (f > 0) {
-                    a->tree[h][m] = Mxmalloc_array(sa_tree_item, LOWPART);
+                if (f == 3) {
+                    undump_int(x);
+                    if (x < 0 || x >= sa_shared_count) {
+                        fprintf(stderr, "bad shared block in %s\n", name);
+                        uexit(1);
+                    }
+                    a->tree[h][m] = sa_shared_blocks[x];
+                    sa_block_refs(a->tree[h][m])++;
+                } else if (f > 0) {
+                    a->tree[h][m] = new_sa_block();
+                    if (f == 2)
+                        register_sa_block(a->tree[h][m]);
                     for (l = 0; l < LOWPART; l++) {
                         if (n == 2) {
                             undump_int(x);
@@ -92,6 +92,7 @@ extern void destroy_sa_tree(sa_tree head);
 
 extern void dump_sa_tree(sa_tree a, const char * name);
 extern sa_tree undump_sa_tree(const char * name);
+extern void reset_sa_shared_blocks(void);
 
 extern void restore_sa_stack(sa_tree a, int gl);
 extern void clear_sa_stack(sa_tree a);
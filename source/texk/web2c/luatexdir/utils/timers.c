@@ -0,0 +1,194 @@
+/*
+
+timers.c
+
+This file is part of LuaTeX.
+
+LuaTeX is free software; you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation;
+either version 2 of the License, or (at your option) any later version.
+
+LuaTeX is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LuaTeX; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*tex
+
+    Here we keep track of the time spent in the main stages of the engine: line
+    breaking, packaging, page building, math, shipout, font embedding, image
+    inclusion and stream compression. The timers are cumulative and only the
+    outermost call of a (recursive) stage is measured. A stage that runs inside
+    another one, like packaging inside line breaking, is also accounted for in
+    the outer stage.
+
+    Reading clocks is not free, so by default the timers are off and the engine
+    only tests a flag. They are turned on from \LUA\ with |status.enabletimers|
+    or implicitly when a telemetry log is opened.
+
+*/
+
+#include "ptexlib.h"
+#include "lua/luatex-api.h"
+
+#include <time.h>
+#ifdef HAVE_GETTIMEOFDAY
+#  include <sys/time.h>
+#endif
+
+const char *phase_timer_names[] = {
+    "linebreak",
+    "hpack",
+    "vpack",
+    "buildpage",
+    "mlist",
+    "shipout",
+    "fonts",
+    "images",
+    "compress",
+    NULL,
+};
+
+phase_timer phase_timers[last_timer];
+
+int phase_timers_enabled = 0;
+
+/*tex
+
+    We prefer the monotonic and process clocks but fall back on what the
+    platform offers otherwise.
+
+*/
+
+static double get_wall_time(void)
+{
+#if defined(CLOCK_MONOTONIC) && !defined(_WIN32)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1.0e9;
+#elif defined(HAVE_GETTIMEOFDAY)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + (double) tv.tv_usec / 1.0e6;
+#else
+    return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static double get_cpu_time(void)
+{
+#if defined(CLOCK_PROCESS_CPUTIME_ID) && !defined(_WIN32)
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1.0e9;
+#else
+    return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+void start_phase_timer(int t)
+{
+    phase_timer *p = &phase_timers[t];
+    if (p->level++ == 0) {
+        p->cpu_start = get_cpu_time();
+        p->wall_start = get_wall_time();
+    }
+}
+
+/*tex
+
+    When the timers get enabled halfway a stage we can end up here without a
+    matching start, so we check the level.
+
+*/
+
+void stop_phase_timer(int t)
+{
+    phase_timer *p = &phase_timers[t];
+    if (p->level > 0 && --p->level == 0) {
+        p->cpu += get_cpu_time() - p->cpu_start;
+        p->wall += get_wall_time() - p->wall_start;
+        p->calls++;
+    }
+}
+
+void reset_phase_timers(void)
+{
+    int t;
+    for (t = 0; t < last_timer; t++) {
+        phase_timers[t].level = 0;
+        phase_timers[t].calls = 0;
+        phase_timers[t].cpu = 0.0;
+        phase_timers[t].wall = 0.0;
+    }
+}
+
+/*tex
+
+    The telemetry log is a file with one \JSON\ object per line. A record is
+    written after every |interval| shipped pages and a last one when the run
+    ends, so that a monitoring tool can follow a long run and compare runs.
+
+*/
+
+static FILE *telemetry_file = NULL;
+static int telemetry_interval = 0;
+static int telemetry_pages = 0;
+static double telemetry_start = 0.0;
+
+static void write_telemetry(const char *event)
+{
+    int t;
+    FILE *f = telemetry_file;
+    flush_pending_lists();
+    fprintf(f, "{\"event\":\"%s\",\"pages\":%d,\"wall\":%.6f,\"cpu\":%.6f",
+        event, total_pages, get_wall_time() - telemetry_start, get_cpu_time());
+    fprintf(f, ",\"var_used\":%d,\"dyn_used\":%d,\"str_ptr\":%d,\"cs_count\":%d,\"luastate_bytes\":%d",
+        var_used, dyn_used, str_ptr, cs_count, luastate_bytes);
+    if (static_pdf != NULL) {
+        fprintf(f, ",\"output_bytes\":%ld", (long) static_pdf->gone);
+    }
+    fprintf(f, ",\"timers\":{");
+    for (t = 0; t < last_timer; t++) {
+        fprintf(f, "%s\"%s\":{\"calls\":%d,\"cpu\":%.6f,\"wall\":%.6f}",
+            (t > 0 ? "," : ""), phase_timer_names[t],
+            phase_timers[t].calls, phase_timers[t].cpu, phase_timers[t].wall);
+    }
+    fprintf(f, "}}\n");
+    fflush(f);
+}
+
+int open_telemetry(const char *filename, int interval)
+{
+    close_telemetry();
+    telemetry_file = fopen(filename, FOPEN_W_MODE);
+    if (telemetry_file == NULL)
+        return 0;
+    telemetry_interval = (interval > 0 ? interval : 1);
+    telemetry_pages = 0;
+    telemetry_start = get_wall_time();
+    phase_timers_enabled = 1;
+    write_telemetry("start");
+    return 1;
+}
+
+void close_telemetry(void)
+{
+    if (telemetry_file != NULL) {
+        write_telemetry("stop");
+        fclose(telemetry_file);
+        telemetry_file = NULL;
+    }
+}
+
+void telemetry_page_shipped(void)
+{
+    if (telemetry_file != NULL && ++telemetry_pages >= telemetry_interval) {
+        telemetry_pages = 0;
+        write_telemetry("page");
+    }
+}
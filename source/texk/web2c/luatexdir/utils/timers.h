@@ -0,0 +1,73 @@
+/* timers.h
+
+    This file is part of LuaTeX.
+
+    LuaTeX is free software; you can redistribute it and/or modify it under the
+    terms of the GNU General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    LuaTeX is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+    A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    LuaTeX; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef TIMERS_H
+#  define TIMERS_H 1
+
+/* the phases we keep track of, the order matches |phase_timer_names| */
+
+typedef enum {
+    linebreak_timer = 0,
+    hpack_timer,
+    vpack_timer,
+    buildpage_timer,
+    mlist_timer,
+    shipout_timer,
+    fonts_timer,
+    images_timer,
+    compress_timer,
+    last_timer,
+} phase_timer_codes;
+
+typedef struct {
+    int level;                  /* nesting, only the outermost call counts */
+    int calls;                  /* number of outermost calls */
+    double cpu;                 /* accumulated process time in seconds */
+    double wall;                /* accumulated elapsed time in seconds */
+    double cpu_start;
+    double wall_start;
+} phase_timer;
+
+extern const char *phase_timer_names[];
+extern phase_timer phase_timers[];
+extern int phase_timers_enabled;
+
+extern void start_phase_timer(int t);
+extern void stop_phase_timer(int t);
+extern void reset_phase_timers(void);
+
+/* these are the ones used in the engine, when disabled we only pay for a test */
+
+#  define phase_timer_start(t) do { \
+    if (phase_timers_enabled)       \
+        start_phase_timer(t);       \
+} while (0)
+
+#  define phase_timer_stop(t) do {  \
+    if (phase_timers_enabled)       \
+        stop_phase_timer(t);        \
+} while (0)
+
+/* the json telemetry log */
+
+extern int open_telemetry(const char *filename, int interval);
+extern void close_telemetry(void);
+extern void telemetry_page_shipped(void);
+
+#endif